@@ -1,33 +1,82 @@
 #include <vector>
 #include <stdexcept>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <utility>
 
 
 
-template <typename T>
+template <typename T, typename Alloc = std::allocator<T>>
 class Deque {
 private:
-  static const size_t size_of_cluster = 16;
+  using ClusterAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<T>;
+  using ClusterTraits = std::allocator_traits<ClusterAlloc>;
+  using MapAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<T*>;
+
+  static constexpr size_t calculate_cluster_shift() {
+    size_t shift = 4;
+    while ((sizeof(T) << (shift + 1)) <= 512) {
+      ++shift;
+    }
+    return shift;
+  }
 
-  std::vector<T*> arr_;
+  static const size_t cluster_shift = calculate_cluster_shift();
+  static const size_t size_of_cluster = size_t(1) << cluster_shift;
+  static const size_t cluster_mask = size_of_cluster - 1;
+
+  [[no_unique_address]] ClusterAlloc alloc_;
+  std::vector<T*, MapAlloc> arr_;
   size_t index_start_ = 0;
   size_t index_end_ = 0;
+  size_t max_spare_clusters_ = std::numeric_limits<size_t>::max();
+
+
+
+  T* allocate_cluster();
+
+  void deallocate_cluster(T*);
+
+  void release_spare_clusters(size_t);
+
+  void check_spare_clusters();
+
+  void swap_with_allocator(Deque&);
 
 
 
 public:
   Deque();
 
+  Deque(const Alloc&);
+
   Deque(const Deque&);
 
+  Deque(const Deque&, const Alloc&);
+
+  Deque(Deque&&);
+
   Deque(size_t);
 
+  Deque(size_t, const Alloc&);
+
   Deque(size_t, const T&);
 
+  Deque(size_t, const T&, const Alloc&);
+
   ~Deque();
 
-  Deque& operator=(Deque);
+  Deque& operator=(const Deque&);
+
+  Deque& operator=(Deque&&);
+
 
 
+  Alloc get_allocator() const;
 
   size_t size() const;
 
@@ -51,13 +100,23 @@ public:
 
 
 
+  void shrink_to_fit();
+
+  void set_max_spare_clusters(size_t);
+
+  size_t memory_usage() const;
+
+  std::vector<std::pair<size_t, size_t>> cluster_ranges(size_t) const;
+
+
+
 
 
   template<bool is_const>
   class common_iterator {
   public:
     using value_type = T;
-    using difference_type = int;
+    using difference_type = std::ptrdiff_t;
     using reference = std::conditional_t<is_const, const T&, T&>;
     using pointer = std::conditional_t<is_const, const T*, T*>;
     using iterator_category = std::random_access_iterator_tag;
@@ -66,24 +125,28 @@ public:
 
   private:
     using container = std::conditional_t<is_const, T*const*, T**>;
-    container ptr_;
-    mutable pointer current_;
-    int index_;
-    mutable bool is_current_;
+    container node_ = nullptr;
+    pointer current_ = nullptr;
+    pointer first_ = nullptr;
+    pointer last_ = nullptr;
+
+    void set_node(container);
 
 
 
   public:
     common_iterator() = default;
 
-    common_iterator(const common_iterator &other) :  ptr_(other.ptr_), current_(other.current_), index_(other.index_), is_current_(other.is_current_) {};
+    common_iterator(const common_iterator &other) = default;
 
-    common_iterator(container ptr, int index) : ptr_(ptr), index_(index), is_current_(false) {};
+    common_iterator(container node, pointer current) : node_(node), current_(current), first_(*node), last_(*node + size_of_cluster) {};
+
+    common_iterator(container node, pointer current, pointer first, pointer last) : node_(node), current_(current), first_(first), last_(last) {};
 
     common_iterator& operator=(const common_iterator& other) = default;
 
-    operator common_iterator<true>() {
-      return common_iterator<true>(ptr_, index_);
+    operator common_iterator<true>() const {
+      return common_iterator<true>(node_, current_, first_, last_);
     }
 
 
@@ -96,13 +159,13 @@ public:
 
     common_iterator operator--(int);
 
-    common_iterator operator+(int) const;
+    common_iterator operator+(difference_type) const;
 
-    common_iterator operator-(int) const;
+    common_iterator operator-(difference_type) const;
 
-    common_iterator& operator+=(int);
+    common_iterator& operator+=(difference_type);
 
-    common_iterator& operator-=(int);
+    common_iterator& operator-=(difference_type);
 
 
 
@@ -120,7 +183,7 @@ public:
 
 
 
-    int operator-(const common_iterator&) const;
+    difference_type operator-(const common_iterator&) const;
 
     reference operator*() const;
 
@@ -168,406 +231,967 @@ public:
   common_iterator<is_const> erase(common_iterator<is_const>);
 
   void swap(Deque&);
+
+
+
+private:
+  template <bool is_const>
+  common_iterator<is_const> iterator_at(size_t) const;
 };
 
 
 
 
 
-template <typename T>
-Deque<T>::Deque() {
-  arr_ = std::vector<T*>(1);
-  arr_[0] = reinterpret_cast<T*>(new char[size_of_cluster * sizeof(T)]);
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque() : Deque(Alloc()) {}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(const Alloc& alloc) : alloc_(alloc), arr_(MapAlloc(alloc)) {
+  arr_.push_back(allocate_cluster());
 }
 
-template <typename T>
-Deque<T>::Deque(const Deque<T>& other) : index_start_(other.index_start_), index_end_(other.index_end_) {
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(const Deque& other) : Deque(other, ClusterTraits::select_on_container_copy_construction(other.alloc_)) {}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(const Deque& other, const Alloc& alloc) : alloc_(alloc), arr_(MapAlloc(alloc)), index_start_(other.index_start_),
+    index_end_(other.index_end_), max_spare_clusters_(other.max_spare_clusters_) {
   size_t size_of_vector = other.arr_.size();
-  arr_ = std::vector<T*>(size_of_vector);
+  arr_.resize(size_of_vector);
   size_t i = 0;
   try {
     for (; i < size_of_vector; ++i) {
-      arr_[i] = reinterpret_cast<T*>(new char[size_of_cluster * sizeof(T)]);
+      arr_[i] = allocate_cluster();
     }
   } catch (...) {
     for (size_t j = 0; j < i; ++j) {
-      delete reinterpret_cast<char*>(arr_[j]);
+      deallocate_cluster(arr_[j]);
     }
     throw;
   }
   i = index_start_;
   try {
     for (; i < index_end_; ++i) {
-      new (arr_[i / size_of_cluster] + i % size_of_cluster) T(other.arr_[i / size_of_cluster][i % size_of_cluster]);
+      ClusterTraits::construct(alloc_, arr_[i >> cluster_shift] + (i & cluster_mask), other.arr_[i >> cluster_shift][i & cluster_mask]);
     }
   } catch (...) {
     for (size_t j = index_start_; j < i; ++j) {
-      (arr_[j / size_of_cluster] + j % size_of_cluster)->~T();
+      ClusterTraits::destroy(alloc_, arr_[j >> cluster_shift] + (j & cluster_mask));
     }
     for (size_t j = 0; j < size_of_vector; ++j) {
-      delete reinterpret_cast<char*>(arr_[j]);
+      deallocate_cluster(arr_[j]);
     }
     throw;
   }
 }
 
-template <typename T>
-Deque<T>::Deque(size_t size) : Deque(size, T()) {}
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(Deque&& other) : alloc_(std::move(other.alloc_)), arr_(std::move(other.arr_)), index_start_(other.index_start_),
+    index_end_(other.index_end_), max_spare_clusters_(other.max_spare_clusters_) {
+  other.arr_.clear();
+  other.index_start_ = 0;
+  other.index_end_ = 0;
+}
 
-template <typename T>
-Deque<T>::Deque(size_t size, const T& value) {
-  size_t size_of_vector = (size + size_of_cluster - 1) / size_of_cluster;
-  arr_ = std::vector<T*>(size_of_vector);
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(size_t size) : Deque(size, T(), Alloc()) {}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(size_t size, const Alloc& alloc) : Deque(size, T(), alloc) {}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(size_t size, const T& value) : Deque(size, value, Alloc()) {}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(size_t size, const T& value, const Alloc& alloc) : alloc_(alloc), arr_(MapAlloc(alloc)) {
+  size_t size_of_vector = (size >> cluster_shift) + 1;
+  arr_.resize(size_of_vector);
   size_t i = 0;
   try {
     for (; i < size_of_vector; ++i) {
-      arr_[i] = reinterpret_cast<T*>(new char[size_of_cluster * sizeof(T)]);
+      arr_[i] = allocate_cluster();
     }
   } catch (...) {
     for (size_t j = 0; j < i; ++j) {
-      delete reinterpret_cast<char*>(arr_[j]);
+      deallocate_cluster(arr_[j]);
     }
     throw;
   }
   i = 0;
   try {
     for (; i < size; ++i) {
-      new (arr_[i / size_of_cluster] + i % size_of_cluster) T(value);
+      ClusterTraits::construct(alloc_, arr_[i >> cluster_shift] + (i & cluster_mask), value);
     }
     index_end_ = size;
   } catch (...) {
     for (size_t j = 0; j < i; ++j) {
-      (arr_[j / size_of_cluster] + j % size_of_cluster)->~T();
+      ClusterTraits::destroy(alloc_, arr_[j >> cluster_shift] + (j & cluster_mask));
     }
     for (size_t j = 0; j < size_of_vector; ++j) {
-      delete reinterpret_cast<char*>(arr_[j]);
+      deallocate_cluster(arr_[j]);
     }
     throw;
   }
 }
 
-template <typename T>
-Deque<T>::~Deque<T>() {
+template <typename T, typename Alloc>
+Deque<T, Alloc>::~Deque() {
   for (size_t i = index_start_; i < index_end_; ++i) {
-    (arr_[i / size_of_cluster] + i % size_of_cluster)->~T();
+    ClusterTraits::destroy(alloc_, arr_[i >> cluster_shift] + (i & cluster_mask));
   }
   for (size_t i = 0; i < arr_.size(); ++i) {
-    delete reinterpret_cast<char*>(arr_[i]);
+    deallocate_cluster(arr_[i]);
   }
 }
 
-template <typename T>
-Deque<T>& Deque<T>::operator=(Deque<T> other) {
-  swap(other);
+template <typename T, typename Alloc>
+Deque<T, Alloc>& Deque<T, Alloc>::operator=(const Deque& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (ClusterTraits::propagate_on_container_copy_assignment::value) {
+    Deque copy(other, other.alloc_);
+    swap_with_allocator(copy);
+  } else {
+    Deque copy(other, alloc_);
+    swap_with_allocator(copy);
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>& Deque<T, Alloc>::operator=(Deque&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (ClusterTraits::propagate_on_container_move_assignment::value) {
+    Deque moved(std::move(other));
+    swap_with_allocator(moved);
+  } else {
+    if (alloc_ == other.alloc_) {
+      Deque moved(std::move(other));
+      swap_with_allocator(moved);
+    } else {
+      Deque copy(other, alloc_);
+      swap_with_allocator(copy);
+    }
+  }
   return *this;
 }
 
+template <typename T, typename Alloc>
+Alloc Deque<T, Alloc>::get_allocator() const {
+  return Alloc(alloc_);
+}
 
 
-template <typename T>
-size_t Deque<T>::size() const {
+
+template <typename T, typename Alloc>
+T* Deque<T, Alloc>::allocate_cluster() {
+  return ClusterTraits::allocate(alloc_, size_of_cluster);
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::deallocate_cluster(T* cluster) {
+  ClusterTraits::deallocate(alloc_, cluster, size_of_cluster);
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::release_spare_clusters(size_t keep) {
+  if (arr_.empty()) {
+    return;
+  }
+  size_t used_first = index_start_ >> cluster_shift;
+  size_t used_last = (index_end_ >> cluster_shift) + 1;
+  size_t spare_back = arr_.size() - used_last;
+  size_t keep_back = std::min(spare_back, keep);
+  size_t keep_front = std::min(used_first, keep - keep_back);
+  for (size_t i = used_last + keep_back; i < arr_.size(); ++i) {
+    deallocate_cluster(arr_[i]);
+  }
+  arr_.resize(used_last + keep_back);
+  size_t release_front = used_first - keep_front;
+  for (size_t i = 0; i < release_front; ++i) {
+    deallocate_cluster(arr_[i]);
+  }
+  arr_.erase(arr_.begin(), arr_.begin() + release_front);
+  index_start_ -= release_front * size_of_cluster;
+  index_end_ -= release_front * size_of_cluster;
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::check_spare_clusters() {
+  if (arr_.empty()) {
+    return;
+  }
+  size_t used_first = index_start_ >> cluster_shift;
+  size_t used_last = (index_end_ >> cluster_shift) + 1;
+  size_t spare = arr_.size() - (used_last - used_first);
+  if (spare > max_spare_clusters_ && spare > used_last - used_first) {
+    release_spare_clusters(max_spare_clusters_);
+  }
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::shrink_to_fit() {
+  release_spare_clusters(0);
+  arr_.shrink_to_fit();
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::set_max_spare_clusters(size_t count) {
+  max_spare_clusters_ = count;
+  check_spare_clusters();
+}
+
+template <typename T, typename Alloc>
+size_t Deque<T, Alloc>::memory_usage() const {
+  return arr_.capacity() * sizeof(T*) + arr_.size() * size_of_cluster * sizeof(T);
+}
+
+template <typename T, typename Alloc>
+std::vector<std::pair<size_t, size_t>> Deque<T, Alloc>::cluster_ranges(size_t parts) const {
+  std::vector<std::pair<size_t, size_t>> ranges;
+  parts = std::max<size_t>(parts, 1);
+  size_t first = 0;
+  for (size_t i = 1; i <= parts && first < size(); ++i) {
+    size_t last = size();
+    if (i < parts) {
+      size_t border = (index_start_ + size() * i / parts + size_of_cluster / 2) & ~cluster_mask;
+      last = border > index_start_ ? std::min(border - index_start_, size()) : 0;
+    }
+    if (last > first) {
+      ranges.emplace_back(first, last);
+      first = last;
+    }
+  }
+  return ranges;
+}
+
+
+
+template <typename T, typename Alloc>
+size_t Deque<T, Alloc>::size() const {
   return index_end_ - index_start_;
 }
 
-template <typename T>
-T& Deque<T>::operator[](size_t pos) {
-  return arr_[(pos + index_start_) / size_of_cluster][(pos + index_start_) % size_of_cluster];
+template <typename T, typename Alloc>
+T& Deque<T, Alloc>::operator[](size_t pos) {
+  return arr_[(pos + index_start_) >> cluster_shift][(pos + index_start_) & cluster_mask];
 }
 
-template <typename T>
-const T& Deque<T>::operator[](size_t pos) const {
-  return arr_[(pos + index_start_) / size_of_cluster][(pos + index_start_) % size_of_cluster];
+template <typename T, typename Alloc>
+const T& Deque<T, Alloc>::operator[](size_t pos) const {
+  return arr_[(pos + index_start_) >> cluster_shift][(pos + index_start_) & cluster_mask];
 }
 
-template <typename T>
-T& Deque<T>::at(size_t pos) {
+template <typename T, typename Alloc>
+T& Deque<T, Alloc>::at(size_t pos) {
   if (pos >= size()) {
     throw std::out_of_range("");
   }
-  return arr_[(pos + index_start_) / size_of_cluster][(pos + index_start_) % size_of_cluster];
+  return arr_[(pos + index_start_) >> cluster_shift][(pos + index_start_) & cluster_mask];
 }
 
-template <typename T>
-const T& Deque<T>::at(size_t pos) const {
+template <typename T, typename Alloc>
+const T& Deque<T, Alloc>::at(size_t pos) const {
   if (pos >= size()) {
     throw std::out_of_range("");
   }
-  return arr_[(pos + index_start_) / size_of_cluster][(pos + index_start_) % size_of_cluster];
+  return arr_[(pos + index_start_) >> cluster_shift][(pos + index_start_) & cluster_mask];
 }
 
 
 
-template <typename T>
-void Deque<T>::push_back(const T& value) {
-  if (index_end_ == arr_.size() * size_of_cluster) {
-    arr_.push_back(reinterpret_cast<T*>(new char[size_of_cluster * sizeof(T)]));
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::push_back(const T& value) {
+  if (index_end_ + 1 >= arr_.size() * size_of_cluster) {
+    T* cluster = allocate_cluster();
+    try {
+      arr_.push_back(cluster);
+    } catch (...) {
+      deallocate_cluster(cluster);
+      throw;
+    }
   }
-  new (arr_[index_end_ / size_of_cluster] + index_end_ % size_of_cluster) T(value);
+  ClusterTraits::construct(alloc_, arr_[index_end_ >> cluster_shift] + (index_end_ & cluster_mask), value);
   ++index_end_;
 }
 
-template <typename T>
-void Deque<T>::pop_back() {
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::pop_back() {
   --index_end_;
-  (arr_[index_end_ / size_of_cluster] + index_end_ % size_of_cluster)->~T();
+  ClusterTraits::destroy(alloc_, arr_[index_end_ >> cluster_shift] + (index_end_ & cluster_mask));
+  if ((index_end_ & cluster_mask) == 0) {
+    check_spare_clusters();
+  }
 }
 
-template <typename T>
-void Deque<T>::push_front(const T& value) {
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::push_front(const T& value) {
+  if (arr_.empty()) {
+    T* cluster = allocate_cluster();
+    try {
+      arr_.push_back(cluster);
+    } catch (...) {
+      deallocate_cluster(cluster);
+      throw;
+    }
+  }
   if (index_start_ == 0) {
-    arr_.insert(arr_.begin(), reinterpret_cast<T*>(new char[size_of_cluster * sizeof(T)]));
+    T* cluster = allocate_cluster();
+    try {
+      arr_.insert(arr_.begin(), cluster);
+    } catch (...) {
+      deallocate_cluster(cluster);
+      throw;
+    }
     index_start_ += size_of_cluster;
     index_end_ += size_of_cluster;
   }
   index_start_ -= 1;
-  new (arr_[index_start_ / size_of_cluster] + index_start_ % size_of_cluster) T(value);
+  ClusterTraits::construct(alloc_, arr_[index_start_ >> cluster_shift] + (index_start_ & cluster_mask), value);
 }
 
-template <typename T>
-void Deque<T>::pop_front() {
-  (arr_[index_start_ / size_of_cluster] + index_start_ % size_of_cluster)->~T();
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::pop_front() {
+  ClusterTraits::destroy(alloc_, arr_[index_start_ >> cluster_shift] + (index_start_ & cluster_mask));
   ++index_start_;
+  if ((index_start_ & cluster_mask) == 0) {
+    check_spare_clusters();
+  }
 }
 
 
 
 
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const>& Deque<T>::common_iterator<is_const>::operator++() {
-  *this += 1;
+typename Deque<T, Alloc>::template common_iterator<is_const>& Deque<T, Alloc>::common_iterator<is_const>::operator++() {
+  ++current_;
+  if (current_ == last_) {
+    set_node(node_ + 1);
+    current_ = first_;
+  }
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const> Deque<T>::common_iterator<is_const>::operator++(int) {
+typename Deque<T, Alloc>::template common_iterator<is_const> Deque<T, Alloc>::common_iterator<is_const>::operator++(int) {
   common_iterator other(*this);
-  *this += 1;
+  ++*this;
   return other;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const>& Deque<T>::common_iterator<is_const>::operator--() {
-  *this -= 1;
+typename Deque<T, Alloc>::template common_iterator<is_const>& Deque<T, Alloc>::common_iterator<is_const>::operator--() {
+  if (current_ == first_) {
+    set_node(node_ - 1);
+    current_ = last_;
+  }
+  --current_;
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const> Deque<T>::common_iterator<is_const>::operator--(int) {
+typename Deque<T, Alloc>::template common_iterator<is_const> Deque<T, Alloc>::common_iterator<is_const>::operator--(int) {
   common_iterator other(*this);
-  *this -= 1;
+  --*this;
   return other;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const> Deque<T>::common_iterator<is_const>::operator+(int count) const {
+typename Deque<T, Alloc>::template common_iterator<is_const> Deque<T, Alloc>::common_iterator<is_const>::operator+(difference_type count) const {
   common_iterator<is_const> other(*this);
   other += count;
   return other;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const> Deque<T>::common_iterator<is_const>::operator-(int count) const {
+typename Deque<T, Alloc>::template common_iterator<is_const> Deque<T, Alloc>::common_iterator<is_const>::operator-(difference_type count) const {
   common_iterator<is_const> other(*this);
   other -= count;
   return other;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const>& Deque<T>::common_iterator<is_const>::operator+=(int count) {
-  index_ += count;
-  if (index_ >= static_cast<int>(size_of_cluster)) {
-    is_current_ = false;
-    ptr_ += index_ / size_of_cluster;
-    index_ %= size_of_cluster;
+typename Deque<T, Alloc>::template common_iterator<is_const>& Deque<T, Alloc>::common_iterator<is_const>::operator+=(difference_type count) {
+  difference_type offset = count + (current_ - first_);
+  if (offset >= 0 && offset < static_cast<difference_type>(size_of_cluster)) {
+    current_ += count;
+  } else {
+    difference_type node_offset = offset >= 0 ? offset >> cluster_shift : -((-offset - 1) >> cluster_shift) - 1;
+    set_node(node_ + node_offset);
+    current_ = first_ + (offset - node_offset * static_cast<difference_type>(size_of_cluster));
   }
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>::template common_iterator<is_const>& Deque<T>::common_iterator<is_const>::operator-=(int count) {
-  index_ -= count;
-  if (index_ < 0) {
-    is_current_ = false;
-    ptr_ -= (-index_ + size_of_cluster - 1) / size_of_cluster;
-    index_ += (-index_ + size_of_cluster - 1) / size_of_cluster * size_of_cluster;
-  }
-  return *this;
+typename Deque<T, Alloc>::template common_iterator<is_const>& Deque<T, Alloc>::common_iterator<is_const>::operator-=(difference_type count) {
+  return *this += -count;
 }
 
+template <typename T, typename Alloc>
+template <bool is_const>
+void Deque<T, Alloc>::common_iterator<is_const>::set_node(container node) {
+  node_ = node;
+  first_ = *node;
+  last_ = first_ + size_of_cluster;
+}
 
 
-template <typename T>
+
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator<(const common_iterator& other) const{
-  return (ptr_ < other.ptr_) || (ptr_ == other.ptr_ && index_ < other.index_);
+bool Deque<T, Alloc>::common_iterator<is_const>::operator<(const common_iterator& other) const{
+  return (node_ < other.node_) || (node_ == other.node_ && current_ < other.current_);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator>(const common_iterator& other) const{
+bool Deque<T, Alloc>::common_iterator<is_const>::operator>(const common_iterator& other) const{
   return other < *this;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator<=(const common_iterator& other) const{
+bool Deque<T, Alloc>::common_iterator<is_const>::operator<=(const common_iterator& other) const{
   return !(*this > other);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator>=(const common_iterator& other) const{
+bool Deque<T, Alloc>::common_iterator<is_const>::operator>=(const common_iterator& other) const{
   return !(*this < other);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator==(const common_iterator& other) const{
-  return (ptr_ == other.ptr_ && index_ == other.index_);
+bool Deque<T, Alloc>::common_iterator<is_const>::operator==(const common_iterator& other) const{
+  return current_ == other.current_;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-bool Deque<T>::common_iterator<is_const>::operator!=(const common_iterator& other) const{
+bool Deque<T, Alloc>::common_iterator<is_const>::operator!=(const common_iterator& other) const{
   return !(*this == other);
 }
 
 
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-int Deque<T>::common_iterator<is_const>::operator-(const common_iterator& other) const{
-  return (ptr_ - other.ptr_) * size_of_cluster + index_ - other.index_;
+typename Deque<T, Alloc>:: template common_iterator<is_const>::difference_type Deque<T, Alloc>::common_iterator<is_const>::operator-(const common_iterator& other) const{
+  return (node_ - other.node_) * static_cast<difference_type>(size_of_cluster) + (current_ - first_) - (other.current_ - other.first_);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>:: template common_iterator<is_const>::reference Deque<T>::common_iterator<is_const>::operator*() const {
-  if (!is_current_) {
-    is_current_ = true;
-    current_ = *ptr_;
-  }
-  return *(current_ + index_);
+typename Deque<T, Alloc>:: template common_iterator<is_const>::reference Deque<T, Alloc>::common_iterator<is_const>::operator*() const {
+  return *current_;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>:: template common_iterator<is_const>::pointer Deque<T>::common_iterator<is_const>::operator->() const {
-  if (!is_current_) {
-    is_current_ = true;
-    current_ = *ptr_;
-  }
-  return (current_ + index_);
+typename Deque<T, Alloc>:: template common_iterator<is_const>::pointer Deque<T, Alloc>::common_iterator<is_const>::operator->() const {
+  return current_;
 }
 
 
 
 
 
-template <typename T>
-typename Deque<T>::iterator Deque<T>::begin() {
-  return Deque<T>::iterator(&arr_[index_start_ / size_of_cluster], index_start_ % size_of_cluster);
+template <typename T, typename Alloc>
+template <bool is_const>
+typename Deque<T, Alloc>:: template common_iterator<is_const> Deque<T, Alloc>::iterator_at(size_t index) const {
+  if (arr_.empty()) {
+    return common_iterator<is_const>();
+  }
+  T** node = const_cast<T**>(arr_.data()) + (index >> cluster_shift);
+  return common_iterator<is_const>(node, *node + (index & cluster_mask));
 }
 
-template <typename T>
-typename Deque<T>::const_iterator Deque<T>::begin() const{
-  return Deque<T>::const_iterator(&arr_[index_start_ / size_of_cluster], index_start_ % size_of_cluster);
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::iterator Deque<T, Alloc>::begin() {
+  return iterator_at<false>(index_start_);
 }
 
-template <typename T>
-typename Deque<T>::const_iterator Deque<T>::cbegin() const {
-  return Deque<T>::const_iterator(&arr_[index_start_ / size_of_cluster], index_start_ % size_of_cluster);
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_iterator Deque<T, Alloc>::begin() const{
+  return iterator_at<true>(index_start_);
 }
 
-template <typename T>
-typename Deque<T>::iterator Deque<T>::end() {
-  return Deque<T>::iterator(&arr_[index_end_ / size_of_cluster], index_end_ % size_of_cluster);
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_iterator Deque<T, Alloc>::cbegin() const {
+  return iterator_at<true>(index_start_);
 }
 
-template <typename T>
-typename Deque<T>::const_iterator Deque<T>::end() const {
-  return Deque<T>::const_iterator(&arr_[index_end_ / size_of_cluster], index_end_ % size_of_cluster);
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::iterator Deque<T, Alloc>::end() {
+  return iterator_at<false>(index_end_);
 }
 
-template <typename T>
-typename Deque<T>::const_iterator Deque<T>::cend() const {
-  return Deque<T>::const_iterator(&arr_[index_end_ / size_of_cluster], index_end_ % size_of_cluster);
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_iterator Deque<T, Alloc>::end() const {
+  return iterator_at<true>(index_end_);
 }
 
-template <typename T>
-typename Deque<T>::reverse_iterator Deque<T>::rbegin() {
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_iterator Deque<T, Alloc>::cend() const {
+  return iterator_at<true>(index_end_);
+}
+
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::reverse_iterator Deque<T, Alloc>::rbegin() {
   return std::make_reverse_iterator(end());
 }
 
-template <typename T>
-typename Deque<T>::const_reverse_iterator Deque<T>::rbegin() const{
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_reverse_iterator Deque<T, Alloc>::rbegin() const{
   return std::make_reverse_iterator(end());
 }
 
-template <typename T>
-typename Deque<T>::const_reverse_iterator Deque<T>::crbegin() const {
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_reverse_iterator Deque<T, Alloc>::crbegin() const {
   return std::make_reverse_iterator(cend());
 }
 
-template <typename T>
-typename Deque<T>::reverse_iterator Deque<T>::rend() {
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::reverse_iterator Deque<T, Alloc>::rend() {
   return std::make_reverse_iterator(begin());
 }
 
-template <typename T>
-typename Deque<T>::const_reverse_iterator Deque<T>::rend() const {
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_reverse_iterator Deque<T, Alloc>::rend() const {
   return std::make_reverse_iterator(begin());
 }
 
-template <typename T>
-typename Deque<T>::const_reverse_iterator Deque<T>::crend() const {
+template <typename T, typename Alloc>
+typename Deque<T, Alloc>::const_reverse_iterator Deque<T, Alloc>::crend() const {
   return std::make_reverse_iterator(cbegin());
 }
 
 
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>:: template common_iterator<is_const> Deque<T>::insert(Deque<T>::common_iterator<is_const> iter, const T& value) {
+typename Deque<T, Alloc>:: template common_iterator<is_const> Deque<T, Alloc>::insert(Deque<T, Alloc>::common_iterator<is_const> iter, const T& value) {
   if (iter == end()) {
     push_back(value);
     return end();
   }
-  int shift = iter - begin();
+  typename common_iterator<is_const>::difference_type shift = iter - begin();
   T val = T(*(end() - 1));
   for (common_iterator<is_const> temp(end() - 1); temp > iter; --temp) {
-    temp->~T();
-    new (&*temp) T(*(temp - 1));
+    ClusterTraits::destroy(alloc_, &*temp);
+    ClusterTraits::construct(alloc_, &*temp, *(temp - 1));
   }
-  iter->~T();
-  new (&*iter) T(value);
+  ClusterTraits::destroy(alloc_, &*iter);
+  ClusterTraits::construct(alloc_, &*iter, value);
   push_back(val);
   return begin() + shift;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 template <bool is_const>
-typename Deque<T>:: template common_iterator<is_const> Deque<T>::erase(Deque<T>::common_iterator<is_const> iter) {
+typename Deque<T, Alloc>:: template common_iterator<is_const> Deque<T, Alloc>::erase(Deque<T, Alloc>::common_iterator<is_const> iter) {
   for (common_iterator<is_const> temp(iter); temp < end() - 1; ++temp) {
-    temp->~T();
-    new (&*temp) T(*(temp + 1));
+    ClusterTraits::destroy(alloc_, &*temp);
+    ClusterTraits::construct(alloc_, &*temp, *(temp + 1));
   }
   pop_back();
   return iter;
 }
 
-template <typename T>
-void Deque<T>::swap(Deque& other) {
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::swap(Deque& other) {
+  if constexpr (ClusterTraits::propagate_on_container_swap::value) {
+    std::swap(alloc_, other.alloc_);
+  }
+  std::swap(arr_, other.arr_);
+  std::swap(index_start_, other.index_start_);
+  std::swap(index_end_, other.index_end_);
+  std::swap(max_spare_clusters_, other.max_spare_clusters_);
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::swap_with_allocator(Deque& other) {
+  std::swap(alloc_, other.alloc_);
   std::swap(arr_, other.arr_);
   std::swap(index_start_, other.index_start_);
   std::swap(index_end_, other.index_end_);
+  std::swap(max_spare_clusters_, other.max_spare_clusters_);
+}
+
+
+
+
+
+template <typename T>
+struct WindowMin {
+  const T& operator()(const T& first, const T& second) const { return second < first ? second : first; }
+};
+
+template <typename T>
+struct WindowMax {
+  const T& operator()(const T& first, const T& second) const { return first < second ? second : first; }
+};
+
+
+
+template <typename T, typename Op = std::plus<T>>
+class SlidingWindow {
+private:
+  static constexpr size_t max_spare_clusters = 4;
+
+  Deque<T> values_;
+  Deque<T> front_aggregates_;
+  T back_aggregate_ = T();
+  [[no_unique_address]] Op op_;
+
+
+
+  void rebuild_front();
+
+
+
+public:
+  SlidingWindow();
+
+  SlidingWindow(const Op&);
+
+
+
+  size_t size() const;
+
+  bool empty() const;
+
+  const T& front() const;
+
+  const T& back() const;
+
+  const T& operator[](size_t) const;
+
+
+
+  void push_back(const T&);
+
+  void pop_front();
+
+  T aggregate() const;
+};
+
+
+
+template <typename T, typename Compare>
+class MonotonicWindow {
+private:
+  static constexpr size_t max_spare_clusters = 4;
+
+  Deque<T> values_;
+  Deque<size_t> candidates_;
+  size_t popped_ = 0;
+  [[no_unique_address]] Compare compare_;
+
+
+
+public:
+  MonotonicWindow();
+
+  MonotonicWindow(const Compare&);
+
+
+
+  size_t size() const;
+
+  bool empty() const;
+
+  const T& front() const;
+
+  const T& back() const;
+
+  const T& operator[](size_t) const;
+
+
+
+  void push_back(const T&);
+
+  void pop_front();
+
+  T aggregate() const;
+};
+
+template <typename T>
+class SlidingWindow<T, WindowMin<T>> : public MonotonicWindow<T, std::less<T>> {
+public:
+  SlidingWindow() = default;
+
+  SlidingWindow(const WindowMin<T>&);
+};
+
+template <typename T>
+class SlidingWindow<T, WindowMax<T>> : public MonotonicWindow<T, std::greater<T>> {
+public:
+  SlidingWindow() = default;
+
+  SlidingWindow(const WindowMax<T>&);
+};
+
+
+
+
+
+template <typename T, typename Op>
+SlidingWindow<T, Op>::SlidingWindow() : SlidingWindow(Op()) {}
+
+template <typename T, typename Op>
+SlidingWindow<T, Op>::SlidingWindow(const Op& op) : op_(op) {
+  values_.set_max_spare_clusters(max_spare_clusters);
+  front_aggregates_.set_max_spare_clusters(max_spare_clusters);
+}
+
+template <typename T, typename Op>
+size_t SlidingWindow<T, Op>::size() const {
+  return values_.size();
+}
+
+template <typename T, typename Op>
+bool SlidingWindow<T, Op>::empty() const {
+  return values_.size() == 0;
+}
+
+template <typename T, typename Op>
+const T& SlidingWindow<T, Op>::front() const {
+  return values_[0];
+}
+
+template <typename T, typename Op>
+const T& SlidingWindow<T, Op>::back() const {
+  return values_[values_.size() - 1];
+}
+
+template <typename T, typename Op>
+const T& SlidingWindow<T, Op>::operator[](size_t pos) const {
+  return values_[pos];
+}
+
+template <typename T, typename Op>
+void SlidingWindow<T, Op>::push_back(const T& value) {
+  T aggregate = values_.size() == front_aggregates_.size() ? value : op_(back_aggregate_, value);
+  values_.push_back(value);
+  back_aggregate_ = std::move(aggregate);
+}
+
+template <typename T, typename Op>
+void SlidingWindow<T, Op>::pop_front() {
+  if (front_aggregates_.size() == 0) {
+    rebuild_front();
+  }
+  front_aggregates_.pop_back();
+  values_.pop_front();
+  if (values_.size() == 0) {
+    back_aggregate_ = T();
+  }
+}
+
+template <typename T, typename Op>
+void SlidingWindow<T, Op>::rebuild_front() {
+  front_aggregates_.push_back(values_[values_.size() - 1]);
+  for (size_t i = values_.size() - 1; i > 0; --i) {
+    front_aggregates_.push_back(op_(values_[i - 1], front_aggregates_[front_aggregates_.size() - 1]));
+  }
+}
+
+template <typename T, typename Op>
+T SlidingWindow<T, Op>::aggregate() const {
+  if (front_aggregates_.size() == 0) {
+    return back_aggregate_;
+  }
+  const T& front_aggregate = front_aggregates_[front_aggregates_.size() - 1];
+  if (front_aggregates_.size() == values_.size()) {
+    return front_aggregate;
+  }
+  return op_(front_aggregate, back_aggregate_);
+}
+
+
+
+template <typename T, typename Compare>
+MonotonicWindow<T, Compare>::MonotonicWindow() : MonotonicWindow(Compare()) {}
+
+template <typename T, typename Compare>
+MonotonicWindow<T, Compare>::MonotonicWindow(const Compare& compare) : compare_(compare) {
+  values_.set_max_spare_clusters(max_spare_clusters);
+  candidates_.set_max_spare_clusters(max_spare_clusters);
+}
+
+template <typename T>
+SlidingWindow<T, WindowMin<T>>::SlidingWindow(const WindowMin<T>&) {}
+
+template <typename T>
+SlidingWindow<T, WindowMax<T>>::SlidingWindow(const WindowMax<T>&) {}
+
+template <typename T, typename Compare>
+size_t MonotonicWindow<T, Compare>::size() const {
+  return values_.size();
+}
+
+template <typename T, typename Compare>
+bool MonotonicWindow<T, Compare>::empty() const {
+  return values_.size() == 0;
+}
+
+template <typename T, typename Compare>
+const T& MonotonicWindow<T, Compare>::front() const {
+  return values_[0];
+}
+
+template <typename T, typename Compare>
+const T& MonotonicWindow<T, Compare>::back() const {
+  return values_[values_.size() - 1];
+}
+
+template <typename T, typename Compare>
+const T& MonotonicWindow<T, Compare>::operator[](size_t pos) const {
+  return values_[pos];
+}
+
+template <typename T, typename Compare>
+void MonotonicWindow<T, Compare>::push_back(const T& value) {
+  values_.push_back(value);
+  while (candidates_.size() != 0 && !compare_(values_[candidates_[candidates_.size() - 1] - popped_], value)) {
+    candidates_.pop_back();
+  }
+  candidates_.push_back(popped_ + values_.size() - 1);
+}
+
+template <typename T, typename Compare>
+void MonotonicWindow<T, Compare>::pop_front() {
+  if (candidates_[0] == popped_) {
+    candidates_.pop_front();
+  }
+  values_.pop_front();
+  ++popped_;
+}
+
+template <typename T, typename Compare>
+T MonotonicWindow<T, Compare>::aggregate() const {
+  if (candidates_.size() == 0) {
+    return T();
+  }
+  return values_[candidates_[0] - popped_];
+}
+
+
+
+
+
+template <typename Func>
+void parallel_run(size_t count, Func task) {
+  if (count == 0) {
+    return;
+  }
+  std::vector<std::exception_ptr> errors(count);
+  std::vector<std::thread> threads;
+  auto run = [&errors, &task](size_t index) {
+    try {
+      task(index);
+    } catch (...) {
+      errors[index] = std::current_exception();
+    }
+  };
+  try {
+    threads.reserve(count);
+    for (size_t i = 1; i < count; ++i) {
+      threads.emplace_back(run, i);
+    }
+  } catch (...) {
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    throw;
+  }
+  run(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (std::exception_ptr& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+inline size_t parallel_default_threads() {
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+template <typename T, typename Alloc, typename Func>
+void parallel_for_each(Deque<T, Alloc>& deque, Func func, size_t threads = parallel_default_threads()) {
+  std::vector<std::pair<size_t, size_t>> ranges = deque.cluster_ranges(threads);
+  parallel_run(ranges.size(), [&](size_t i) {
+    std::for_each(deque.begin() + ranges[i].first, deque.begin() + ranges[i].second, func);
+  });
+}
+
+template <typename T, typename Alloc, typename U, typename UAlloc, typename Op>
+void parallel_transform(const Deque<T, Alloc>& source, Deque<U, UAlloc>& destination, Op op, size_t threads = parallel_default_threads()) {
+  if (destination.size() < source.size()) {
+    throw std::out_of_range("parallel_transform");
+  }
+  std::vector<std::pair<size_t, size_t>> ranges = source.cluster_ranges(threads);
+  parallel_run(ranges.size(), [&](size_t i) {
+    std::transform(source.begin() + ranges[i].first, source.begin() + ranges[i].second, destination.begin() + ranges[i].first, op);
+  });
+}
+
+template <typename T, typename Alloc, typename R, typename Op>
+R parallel_reduce(const Deque<T, Alloc>& deque, R init, Op op, size_t threads = parallel_default_threads()) {
+  std::vector<std::pair<size_t, size_t>> ranges = deque.cluster_ranges(threads);
+  std::vector<R> results(ranges.size(), init);
+  parallel_run(ranges.size(), [&](size_t i) {
+    auto iter = deque.begin() + ranges[i].first;
+    R result = *iter;
+    for (++iter; iter != deque.begin() + ranges[i].second; ++iter) {
+      result = op(std::move(result), *iter);
+    }
+    results[i] = std::move(result);
+  });
+  for (R& result : results) {
+    init = op(std::move(init), std::move(result));
+  }
+  return init;
+}
+
+template <typename T, typename Alloc, typename Compare = std::less<T>>
+void parallel_sort(Deque<T, Alloc>& deque, Compare compare = Compare(), size_t threads = parallel_default_threads()) {
+  std::vector<std::pair<size_t, size_t>> ranges = deque.cluster_ranges(threads);
+  parallel_run(ranges.size(), [&](size_t i) {
+    std::sort(deque.begin() + ranges[i].first, deque.begin() + ranges[i].second, compare);
+  });
+  while (ranges.size() > 1) {
+    std::vector<std::pair<size_t, size_t>> merged((ranges.size() + 1) / 2);
+    parallel_run(merged.size(), [&](size_t i) {
+      if (2 * i + 1 == ranges.size()) {
+        merged[i] = ranges[2 * i];
+        return;
+      }
+      auto first = deque.begin() + ranges[2 * i].first;
+      auto middle = deque.begin() + ranges[2 * i].second;
+      auto last = deque.begin() + ranges[2 * i + 1].second;
+      std::inplace_merge(first, middle, last, compare);
+      merged[i] = {ranges[2 * i].first, ranges[2 * i + 1].second};
+    });
+    ranges.swap(merged);
+  }
 }
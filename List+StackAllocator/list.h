@@ -1,4 +1,20 @@
 #include <memory>
+#include <new>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <tuple>
+#include <string>
+#include <optional>
+#include <cassert>
+#include <cstring>
+#include "thread_cache.h"
 
 template <size_t N>
 class StackStorage {
@@ -31,114 +47,3476 @@ public:
   T* allocate(size_t size) {
     void* p = reinterpret_cast<void*>(storage_->ptr_);
     size_t space = N - (storage_->ptr_ - storage_->buffer_);
-    std::align(alignof(T), sizeof(T) * size, p, space);
+    if (std::align(alignof(T), sizeof(T) * size, p, space) == nullptr) {
+      throw std::bad_alloc();
+    }
     storage_->ptr_ = reinterpret_cast<char*>(p) + size * sizeof(T);
     return reinterpret_cast<T*>(p);
   }
 
-  void deallocate(const T*, size_t) {}
+  void deallocate(const T*, size_t) {}
+
+  using is_monotonic = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = StackAllocator<U, N>;
+  };
+
+  template <typename S, size_t M>
+  bool operator==(const StackAllocator<S, M>& other) const {
+    return static_cast<const void*>(storage_) == static_cast<const void*>(other.storage_);
+  }
+
+  template <typename S, size_t M>
+  bool operator!=(const StackAllocator<S, M>& other) const {
+    return !(*this == other);
+  }
+
+  StackAllocator select_on_container_copy_construction() { return *this; }
+
+  using propagate_on_container_copy_assignment = std::true_type;
+
+  template <typename U, size_t M>
+  friend class StackAllocator;
+};
+
+template <size_t N>
+class MonotonicArena {
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  static constexpr size_t header_size = (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  alignas(std::max_align_t) char buffer_[N];
+  char* ptr_ = buffer_;
+  char* end_ = buffer_ + N;
+  Block* first_ = nullptr;
+  Block* last_ = nullptr;
+  Block* current_ = nullptr;
+  size_t used_before_current_ = 0;
+  size_t high_water_mark_ = 0;
+  size_t next_block_size_ = std::max<size_t>(2 * N, 1024);
+
+  const char* current_begin() const { return current_ == nullptr ? buffer_ : reinterpret_cast<const char*>(current_) + header_size; }
+
+  void next_block(size_t bytes, size_t alignment) {
+    size_t needed = bytes + alignment + header_size;
+    used_before_current_ += ptr_ - current_begin();
+    Block* block = current_ == nullptr ? first_ : current_->next;
+    while (block != nullptr && block->size < needed) {
+      block = block->next;
+    }
+    if (block == nullptr) {
+      size_t size = std::max(next_block_size_, needed);
+      block = static_cast<Block*>(::operator new(size));
+      block->next = nullptr;
+      block->size = size;
+      (last_ == nullptr ? first_ : last_->next) = block;
+      last_ = block;
+      next_block_size_ = size * 2;
+    }
+    current_ = block;
+    ptr_ = reinterpret_cast<char*>(block) + header_size;
+    end_ = reinterpret_cast<char*>(block) + block->size;
+  }
+
+public:
+  MonotonicArena() = default;
+
+  MonotonicArena(MonotonicArena&) = delete;
+
+  MonotonicArena& operator=(MonotonicArena&) = delete;
+
+  ~MonotonicArena() { release(); }
+
+  void* allocate(size_t bytes, size_t alignment) {
+    void* p = ptr_;
+    size_t space = end_ - ptr_;
+    if (std::align(alignment, bytes, p, space) == nullptr) {
+      next_block(bytes, alignment);
+      p = ptr_;
+      space = end_ - ptr_;
+      std::align(alignment, bytes, p, space);
+    }
+    ptr_ = static_cast<char*>(p) + bytes;
+    high_water_mark_ = std::max(high_water_mark_, bytes_used());
+    return p;
+  }
+
+  void reset() {
+    current_ = nullptr;
+    ptr_ = buffer_;
+    end_ = buffer_ + N;
+    used_before_current_ = 0;
+  }
+
+  void release() {
+    while (first_ != nullptr) {
+      Block* next = first_->next;
+      ::operator delete(first_);
+      first_ = next;
+    }
+    last_ = nullptr;
+    next_block_size_ = std::max<size_t>(2 * N, 1024);
+    reset();
+  }
+
+  size_t bytes_used() const { return used_before_current_ + (ptr_ - current_begin()); }
+
+  size_t high_water_mark() const { return high_water_mark_; }
+
+  size_t heap_bytes() const {
+    size_t bytes = 0;
+    for (Block* block = first_; block != nullptr; block = block->next) {
+      bytes += block->size;
+    }
+    return bytes;
+  }
+};
+
+template <typename T, size_t N>
+class ArenaAllocator {
+  MonotonicArena<N>* arena_;
+
+public:
+  using value_type = T;
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U, N>& other) : arena_(other.arena_) {}
+
+  ArenaAllocator(MonotonicArena<N>& arena) : arena_(&arena) {}
+
+  T* allocate(size_t size) {
+    if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(arena_->allocate(size * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(const T*, size_t) {}
+
+  using is_monotonic = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = ArenaAllocator<U, N>;
+  };
+
+  template <typename S>
+  bool operator==(const ArenaAllocator<S, N>& other) const {
+    return arena_ == other.arena_;
+  }
+
+  template <typename S>
+  bool operator!=(const ArenaAllocator<S, N>& other) const {
+    return !(*this == other);
+  }
+
+  using propagate_on_container_copy_assignment = std::true_type;
+
+  template <typename U, size_t M>
+  friend class ArenaAllocator;
+};
+
+class PoolStorage {
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct Slab {
+    Slab* next;
+  };
+
+  static constexpr size_t granularity = alignof(std::max_align_t);
+  static constexpr size_t size_classes = 32;
+  static constexpr size_t max_pooled_size = granularity * size_classes;
+  static constexpr size_t min_slab_size = 4096;
+  static constexpr size_t max_slab_size = 1 << 20;
+
+  FreeBlock* free_lists_[size_classes] = {};
+  Slab* slabs_ = nullptr;
+  char* ptr_ = nullptr;
+  char* end_ = nullptr;
+  size_t next_slab_size_ = min_slab_size;
+
+  static size_t size_class(size_t bytes) { return (bytes == 0 ? 0 : (bytes - 1) / granularity); }
+
+  static bool is_pooled(size_t bytes, size_t alignment) { return bytes <= max_pooled_size && alignment <= granularity; }
+
+  void add_slab(size_t bytes) {
+    size_t slab_size = std::max(next_slab_size_, bytes + granularity);
+    Slab* slab = static_cast<Slab*>(::operator new(slab_size));
+    slab->next = slabs_;
+    slabs_ = slab;
+    ptr_ = reinterpret_cast<char*>(slab) + granularity;
+    end_ = reinterpret_cast<char*>(slab) + slab_size;
+    next_slab_size_ = std::min(next_slab_size_ * 2, max_slab_size);
+  }
+
+public:
+  PoolStorage() = default;
+
+  PoolStorage(PoolStorage&) = delete;
+
+  PoolStorage& operator=(PoolStorage&) = delete;
+
+  ~PoolStorage() { release(); }
+
+  void* allocate(size_t bytes, size_t alignment) {
+    if (!is_pooled(bytes, alignment)) {
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    size_t index = size_class(bytes);
+    if (free_lists_[index] != nullptr) {
+      FreeBlock* block = free_lists_[index];
+      free_lists_[index] = block->next;
+      return block;
+    }
+    size_t block_size = (index + 1) * granularity;
+    if (static_cast<size_t>(end_ - ptr_) < block_size) {
+      add_slab(block_size);
+    }
+    void* block = ptr_;
+    ptr_ += block_size;
+    return block;
+  }
+
+  void deallocate(void* ptr, size_t bytes, size_t alignment) {
+    if (!is_pooled(bytes, alignment)) {
+      ::operator delete(ptr, std::align_val_t(alignment));
+      return;
+    }
+    size_t index = size_class(bytes);
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_lists_[index];
+    free_lists_[index] = block;
+  }
+
+  void release() {
+    while (slabs_ != nullptr) {
+      Slab* next = slabs_->next;
+      ::operator delete(slabs_);
+      slabs_ = next;
+    }
+    std::fill(free_lists_, free_lists_ + size_classes, nullptr);
+    ptr_ = nullptr;
+    end_ = nullptr;
+    next_slab_size_ = min_slab_size;
+  }
+};
+
+template <typename T>
+class PoolAllocator {
+  PoolStorage* storage_;
+
+public:
+  using value_type = T;
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : storage_(other.storage_) {}
+
+  PoolAllocator(PoolStorage& storage) : storage_(&storage) {}
+
+  T* allocate(size_t size) {
+    if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(storage_->allocate(size * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t size) { storage_->deallocate(ptr, size * sizeof(T), alignof(T)); }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return storage_ == other.storage_;
+  }
+
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return !(*this == other);
+  }
+
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  friend class PoolAllocator;
+};
+
+template <typename T>
+class ThreadCachingAllocator {
+public:
+  using value_type = T;
+
+  ThreadCachingAllocator() = default;
+
+  template<typename U>
+  ThreadCachingAllocator(const ThreadCachingAllocator<U>&) {}
+
+  T* allocate(size_t size) {
+    if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(ThreadCache::allocate(size * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t size) { ThreadCache::deallocate(ptr, size * sizeof(T), alignof(T)); }
+
+  template <typename U>
+  bool operator==(const ThreadCachingAllocator<U>&) const {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const ThreadCachingAllocator<U>&) const {
+    return false;
+  }
+};
+
+class AllocationStats {
+  struct Site {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<size_t> count{0};
+  };
+
+  static constexpr size_t histogram_size = 64;
+  static constexpr size_t max_sites = 64;
+
+  std::atomic<size_t> allocations_{0};
+  std::atomic<size_t> deallocations_{0};
+  std::atomic<size_t> bytes_allocated_{0};
+  std::atomic<size_t> bytes_deallocated_{0};
+  std::atomic<size_t> live_bytes_{0};
+  std::atomic<size_t> peak_live_bytes_{0};
+  std::atomic<size_t> histogram_[histogram_size] = {};
+  std::atomic<size_t> sample_period_{0};
+  std::atomic<size_t> sample_counter_{0};
+  Site sites_[max_sites];
+
+  static size_t bucket(size_t bytes) {
+    size_t index = 0;
+    while (bytes != 0) {
+      bytes >>= 1;
+      ++index;
+    }
+    return index;
+  }
+
+  static const char*& current_site() {
+    static thread_local const char* site = nullptr;
+    return site;
+  }
+
+  void record_site(const char* name) {
+    size_t start = (reinterpret_cast<uintptr_t>(name) >> 4) % max_sites;
+    for (size_t i = 0; i < max_sites; ++i) {
+      Site& site = sites_[(start + i) % max_sites];
+      const char* expected = nullptr;
+      if (site.name.load(std::memory_order_relaxed) == name ||
+          site.name.compare_exchange_strong(expected, name, std::memory_order_relaxed) || expected == name) {
+        site.count.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  static void append_escaped(std::string& json, const char* text) {
+    for (; *text != 0; ++text) {
+      if (*text == '"' || *text == '\\') {
+        json += '\\';
+      }
+      json += *text;
+    }
+  }
+
+public:
+  class Scope {
+    const char* previous_;
+
+  public:
+    explicit Scope(const char* site) : previous_(current_site()) { current_site() = site; }
+
+    Scope(const Scope&) = delete;
+
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() { current_site() = previous_; }
+  };
+
+  AllocationStats() = default;
+
+  AllocationStats(AllocationStats&) = delete;
+
+  AllocationStats& operator=(AllocationStats&) = delete;
+
+  void set_sampling(size_t period) { sample_period_.store(period, std::memory_order_relaxed); }
+
+  void on_allocate(size_t bytes) {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+    histogram_[bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+    size_t live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = peak_live_bytes_.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    size_t period = sample_period_.load(std::memory_order_relaxed);
+    const char* site = current_site();
+    if (period != 0 && site != nullptr && sample_counter_.fetch_add(1, std::memory_order_relaxed) % period == 0) {
+      record_site(site);
+    }
+  }
+
+  void on_deallocate(size_t bytes) {
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_deallocated_.fetch_add(bytes, std::memory_order_relaxed);
+    live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  size_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+
+  size_t deallocations() const { return deallocations_.load(std::memory_order_relaxed); }
+
+  size_t bytes_allocated() const { return bytes_allocated_.load(std::memory_order_relaxed); }
+
+  size_t bytes_deallocated() const { return bytes_deallocated_.load(std::memory_order_relaxed); }
+
+  size_t live_bytes() const { return live_bytes_.load(std::memory_order_relaxed); }
+
+  size_t peak_live_bytes() const { return peak_live_bytes_.load(std::memory_order_relaxed); }
+
+  void reset() {
+    allocations_.store(0, std::memory_order_relaxed);
+    deallocations_.store(0, std::memory_order_relaxed);
+    bytes_allocated_.store(0, std::memory_order_relaxed);
+    bytes_deallocated_.store(0, std::memory_order_relaxed);
+    peak_live_bytes_.store(live_bytes_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sample_counter_.store(0, std::memory_order_relaxed);
+    for (std::atomic<size_t>& count : histogram_) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    for (Site& site : sites_) {
+      site.count.store(0, std::memory_order_relaxed);
+      site.name.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  std::string to_json() const {
+    std::string json = "{\"allocations\":" + std::to_string(allocations()) +
+                       ",\"deallocations\":" + std::to_string(deallocations()) +
+                       ",\"bytes_allocated\":" + std::to_string(bytes_allocated()) +
+                       ",\"bytes_deallocated\":" + std::to_string(bytes_deallocated()) +
+                       ",\"live_bytes\":" + std::to_string(live_bytes()) +
+                       ",\"peak_live_bytes\":" + std::to_string(peak_live_bytes()) + ",\"histogram\":[";
+    bool first = true;
+    for (size_t i = 0; i < histogram_size; ++i) {
+      size_t count = histogram_[i].load(std::memory_order_relaxed);
+      if (count == 0) {
+        continue;
+      }
+      size_t min = i == 0 ? 0 : size_t(1) << (i - 1);
+      size_t max = i == 0 ? 0 : min + (min - 1);
+      json += (first ? "" : ",") + std::string("{\"min\":") + std::to_string(min) + ",\"max\":" + std::to_string(max) +
+              ",\"count\":" + std::to_string(count) + "}";
+      first = false;
+    }
+    json += "],\"sites\":[";
+    first = true;
+    for (const Site& site : sites_) {
+      const char* name = site.name.load(std::memory_order_relaxed);
+      if (name == nullptr) {
+        continue;
+      }
+      json += (first ? "" : ",") + std::string("{\"site\":\"");
+      append_escaped(json, name);
+      json += "\",\"count\":" + std::to_string(site.count.load(std::memory_order_relaxed)) + "}";
+      first = false;
+    }
+    json += "]}";
+    return json;
+  }
+};
+
+template <typename Alloc>
+class TracingAllocator {
+  using Traits = std::allocator_traits<Alloc>;
+
+  [[no_unique_address]] Alloc alloc_;
+  AllocationStats* stats_;
+
+  template <typename A, typename = void>
+  struct monotonic_tag : std::false_type {};
+
+  template <typename A>
+  struct monotonic_tag<A, std::void_t<typename A::is_monotonic>> : A::is_monotonic {};
+
+public:
+  using value_type = typename Traits::value_type;
+  using is_monotonic = std::bool_constant<monotonic_tag<Alloc>::value>;
+  using propagate_on_container_copy_assignment = typename Traits::propagate_on_container_copy_assignment;
+  using propagate_on_container_move_assignment = typename Traits::propagate_on_container_move_assignment;
+  using propagate_on_container_swap = typename Traits::propagate_on_container_swap;
+
+  TracingAllocator(AllocationStats& stats, const Alloc& alloc = Alloc()) : alloc_(alloc), stats_(&stats) {}
+
+  template <typename Other>
+  TracingAllocator(const TracingAllocator<Other>& other) : alloc_(other.alloc_), stats_(other.stats_) {}
+
+  value_type* allocate(size_t size) {
+    value_type* ptr = Traits::allocate(alloc_, size);
+    stats_->on_allocate(size * sizeof(value_type));
+    return ptr;
+  }
+
+  void deallocate(value_type* ptr, size_t size) {
+    stats_->on_deallocate(size * sizeof(value_type));
+    Traits::deallocate(alloc_, ptr, size);
+  }
+
+  AllocationStats& stats() const { return *stats_; }
+
+  const Alloc& inner_allocator() const { return alloc_; }
+
+  TracingAllocator select_on_container_copy_construction() const {
+    return TracingAllocator(*stats_, Traits::select_on_container_copy_construction(alloc_));
+  }
+
+  template <typename U>
+  struct rebind {
+    using other = TracingAllocator<typename Traits:: template rebind_alloc<U>>;
+  };
+
+  template <typename Other>
+  bool operator==(const TracingAllocator<Other>& other) const {
+    return stats_ == other.stats_ && alloc_ == other.alloc_;
+  }
+
+  template <typename Other>
+  bool operator!=(const TracingAllocator<Other>& other) const {
+    return !(*this == other);
+  }
+
+  template <typename Other>
+  friend class TracingAllocator;
+};
+
+struct ListBaseNode {
+  ListBaseNode* prev = nullptr;
+  ListBaseNode* next = nullptr;
+
+  static void link(ListBaseNode* next, ListBaseNode* node) {
+    ListBaseNode* prev = next->prev;
+    prev->next = node;
+    node->prev = prev;
+    node->next = next;
+    next->prev = node;
+  }
+
+  static void unlink(ListBaseNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+  }
+
+  static void relink_fake_node(ListBaseNode& fake_node, ListBaseNode& old_fake_node) {
+    if (fake_node.next == &old_fake_node) {
+      fake_node.next = &fake_node;
+      fake_node.prev = &fake_node;
+    } else {
+      fake_node.next->prev = &fake_node;
+      fake_node.prev->next = &fake_node;
+    }
+  }
+};
+
+template <typename Container, bool is_const>
+class ListIterator {
+public:
+  using value_type = typename Container::value_type;
+  using difference_type = std::ptrdiff_t;
+  using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+  using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+private:
+  using basenode_pointer = std::conditional_t<is_const, const ListBaseNode*, ListBaseNode*>;
+
+  basenode_pointer ptr_ = nullptr;
+
+public:
+  ListIterator() = default;
+
+  ListIterator(basenode_pointer ptr) : ptr_(ptr) {}
+
+  operator ListIterator<Container, true>() const { return ListIterator<Container, true>(ptr_); }
+
+  ListIterator& operator++() {
+    ptr_ = ptr_->next;
+    return *this;
+  }
+
+  ListIterator operator++(int) {
+    ListIterator temp = *this;
+    ptr_ = ptr_->next;
+    return temp;
+  }
+
+  ListIterator& operator--() {
+    ptr_ = ptr_->prev;
+    return *this;
+  }
+
+  ListIterator operator--(int) {
+    ListIterator temp = *this;
+    ptr_ = ptr_->prev;
+    return temp;
+  }
+
+  bool operator==(const ListIterator& other) const { return ptr_ == other.ptr_; }
+
+  bool operator!=(const ListIterator& other) const { return ptr_ != other.ptr_; }
+
+  reference operator*() const { return *Container::value_of(ptr_); }
+
+  pointer operator->() const { return Container::value_of(ptr_); }
+
+  friend Container;
+};
+
+template <typename T, typename Alloc = std::allocator<T>>
+class List {
+
+  using BaseNode = ListBaseNode;
+
+  struct Node: BaseNode {
+    T value;
+
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  using NodeAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  template <typename A, typename = void>
+  struct is_monotonic : std::false_type {};
+
+  template <typename A>
+  struct is_monotonic<A, std::void_t<typename A::is_monotonic>> : A::is_monotonic {};
+
+  template <typename InputIt>
+  using RequireInputIter = std::enable_if_t<std::is_convertible_v<
+      typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>>;
+
+  [[no_unique_address]] NodeAlloc alloc_;
+  BaseNode fake_node_ = {&fake_node_, &fake_node_};
+  size_t sz_ = 0;
+
+public:
+  using value_type = T;
+
+  List();
+
+  List(size_t);
+
+  List(size_t, const T&);
+
+  List(const Alloc&);
+
+  List(size_t, const Alloc&);
+
+  List(size_t, const T&, const Alloc&);
+
+  template <typename InputIt, typename = RequireInputIter<InputIt>>
+  List(InputIt, InputIt, const Alloc& = Alloc());
+
+  List(const List&);
+
+  List(List&&);
+
+  List& operator=(const List&);
+
+  List& operator=(List&&);
+
+  ~List();
+
+  Alloc get_allocator() const;
+
+  size_t size() const;
+
+  void push_back(const T&);
+
+  void push_back(T&&);
+
+  void push_front(const T&);
+
+  void push_front(T&&);
+
+  void pop_back();
+
+  void pop_front();
+
+  template <typename... Args>
+  T& emplace_back(Args&&...);
+
+  template <typename... Args>
+  T& emplace_front(Args&&...);
+
+  void assign(size_t, const T&);
+
+  template <typename InputIt, typename = RequireInputIter<InputIt>>
+  void assign(InputIt, InputIt);
+
+  template <bool is_const>
+  using common_iterator = ListIterator<List, is_const>;
+
+  using iterator = common_iterator<false>;
+  using const_iterator = common_iterator<true>;
+
+  class node_type {
+    Node* node_ = nullptr;
+    std::optional<NodeAlloc> alloc_;
+
+    node_type(Node* node, const NodeAlloc& alloc) : node_(node), alloc_(alloc) {}
+
+  public:
+    node_type() = default;
+
+    node_type(node_type&& other) : node_(other.node_), alloc_(std::move(other.alloc_)) {
+      other.node_ = nullptr;
+      other.alloc_.reset();
+    }
+
+    node_type& operator=(node_type&&);
+
+    ~node_type();
+
+    bool empty() const { return node_ == nullptr; }
+
+    explicit operator bool() const { return node_ != nullptr; }
+
+    T& value() const { return node_->value; }
+
+    Alloc get_allocator() const { return Alloc(*alloc_); }
+
+    friend class List;
+  };
+
+  iterator begin();
+
+  const_iterator begin() const;
+
+  const_iterator cbegin() const;
+
+  iterator end();
+
+  const_iterator end() const;
+
+  const_iterator cend() const;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  reverse_iterator rbegin();
+
+  const_reverse_iterator rbegin() const;
+
+  const_reverse_iterator crbegin() const;
+
+  reverse_iterator rend();
+
+  const_reverse_iterator rend() const;
+
+  const_reverse_iterator crend() const;
+
+  iterator insert(const_iterator, const T&);
+
+  iterator insert(const_iterator, T&&);
+
+  iterator insert(const_iterator, size_t, const T&);
+
+  template <typename InputIt, typename = RequireInputIter<InputIt>>
+  iterator insert(const_iterator, InputIt, InputIt);
+
+  template <typename... Args>
+  iterator emplace(const_iterator, Args&&...);
+
+  iterator insert(const_iterator, node_type&&);
+
+  node_type extract(const_iterator);
+
+  iterator erase(const_iterator);
+
+  void clear();
+
+  void swap(List&);
+
+  void splice(const_iterator, List&);
+
+  void splice(const_iterator, List&&);
+
+  void splice(const_iterator, List&, const_iterator);
+
+  void splice(const_iterator, List&&, const_iterator);
+
+  void splice(const_iterator, List&, const_iterator, const_iterator);
+
+  void splice(const_iterator, List&&, const_iterator, const_iterator);
+
+  void merge(List&);
+
+  void merge(List&&);
+
+  template <typename Compare>
+  void merge(List&, Compare);
+
+  template <typename Compare>
+  void merge(List&&, Compare);
+
+  void sort();
+
+  template <typename Compare>
+  void sort(Compare);
+
+  void compact();
+
+private:
+  template <typename Construct>
+  iterator insert_nodes(const_iterator, size_t, Construct);
+
+  void swap_nodes(List&);
+
+  bool allocator_equal(List&);
+
+  List take_range(List&, const_iterator, const_iterator);
+
+  static void transfer(BaseNode*, BaseNode*, BaseNode*);
+
+  static T* value_of(BaseNode*);
+
+  static const T* value_of(const BaseNode*);
+
+  template <typename, bool>
+  friend class ListIterator;
+
+  template <typename Compare>
+  static void merge_runs(BaseNode*&, BaseNode*, Compare&);
+};
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::swap_nodes(List& other) {
+  std::swap(fake_node_, other.fake_node_);
+  ListBaseNode::relink_fake_node(fake_node_, other.fake_node_);
+  ListBaseNode::relink_fake_node(other.fake_node_, fake_node_);
+  std::swap(sz_, other.sz_);
+}
+
+template <typename T, typename Alloc>
+T* List<T, Alloc>::value_of(BaseNode* node) {
+  return std::addressof(static_cast<Node*>(node)->value);
+}
+
+template <typename T, typename Alloc>
+const T* List<T, Alloc>::value_of(const BaseNode* node) {
+  return std::addressof(static_cast<const Node*>(node)->value);
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List() : List(Alloc()) {}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(size_t sz) : List(sz, Alloc()) {}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(size_t sz, const T& value) : List(sz, value, Alloc()) {}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(const Alloc& alloc) : alloc_(alloc) {}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(size_t sz, const Alloc& alloc) : alloc_(alloc) {
+  try {
+    for (size_t i = 0 ; i < sz; i++) {
+      emplace(end());
+    }
+  } catch (...) {
+    while (sz_ != 0) {
+      pop_back();
+    }
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(size_t sz, const T& value, const Alloc& alloc ) : alloc_(alloc) {
+  insert(end(), sz, value);
+}
+
+template <typename T, typename Alloc>
+template <typename InputIt, typename>
+List<T, Alloc>::List(InputIt first, InputIt last, const Alloc& alloc) : alloc_(alloc) {
+  insert(end(), first, last);
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(const List& other) : alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())) {
+  insert(end(), other.begin(), other.end());
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::List(List&& other) : alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())){
+  swap_nodes(other);
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>& List<T, Alloc>::operator=(const List& other) {
+  if (std::allocator_traits<Alloc>::propagate_on_container_copy_assignment::value) {
+    alloc_ = other.alloc_;
+  }
+
+  List temp = other;
+  swap_nodes(temp);
+  return *this;
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>& List<T, Alloc>::operator=(List&& other) {
+  while (sz_ != 0) {
+    pop_back();
+  }
+  if (std::allocator_traits<Alloc>::propagate_on_container_copy_assignment::value) {
+    alloc_ = other.alloc_;
+  }
+  swap_nodes(other);
+  return *this;
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::~List() {
+  while (sz_ != 0) {
+    pop_back();
+  }
+}
+
+template <typename T, typename Alloc>
+Alloc List<T, Alloc>::get_allocator() const { return typename NodeTraits:: template rebind_alloc<T>(alloc_); }
+
+template <typename T, typename Alloc>
+size_t List<T, Alloc>::size() const { return sz_; }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_back(const T& value) { insert(end(), value); }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_back(T&& value) { insert(end(), std::move(value)); }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_front(const T& value) { insert(begin(), value); }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_front(T&& value) { insert(begin(), std::move(value)); }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::pop_back() { erase(--end()); }
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::pop_front() { erase(begin()); }
+
+template <typename T, typename Alloc>
+template <typename... Args>
+T& List<T, Alloc>::emplace_back(Args&&... args) {
+  return *emplace(end(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+T& List<T, Alloc>::emplace_front(Args&&... args) {
+  return *emplace(begin(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::assign(size_t count, const T& value) {
+  List temp(get_allocator());
+  temp.insert(temp.end(), count, value);
+  swap_nodes(temp);
+}
+
+template <typename T, typename Alloc>
+template <typename InputIt, typename>
+void List<T, Alloc>::assign(InputIt first, InputIt last) {
+  List temp(get_allocator());
+  temp.insert(temp.end(), first, last);
+  swap_nodes(temp);
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::begin() {
+  return iterator(static_cast<typename iterator::basenode_pointer>(fake_node_.next));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_iterator List<T, Alloc>::begin() const {
+  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(fake_node_.next));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_iterator List<T, Alloc>::cbegin() const {
+  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(fake_node_.next));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::end() {
+  return iterator(static_cast<typename iterator::basenode_pointer>(&fake_node_));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_iterator List<T, Alloc>::end() const {
+  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(&fake_node_));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_iterator List<T, Alloc>::cend() const {
+  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(&fake_node_));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rbegin() {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rbegin() const {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crbegin() const {
+  return std::make_reverse_iterator(cend());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rend() {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rend() const {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crend() const {
+  return std::make_reverse_iterator(cbegin());
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, const T& value) {
+  return emplace(iter, value);
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, T&& value) {
+  return emplace(iter, std::move(value));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, size_t count, const T& value) {
+  return insert_nodes(iter, count, [&](Node* node) {
+    NodeTraits::construct(alloc_, node, value);
+  });
+}
+
+template <typename T, typename Alloc>
+template <typename InputIt, typename>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, InputIt first, InputIt last) {
+  using category = typename std::iterator_traits<InputIt>::iterator_category;
+  if constexpr (std::is_convertible_v<category, std::forward_iterator_tag>) {
+    size_t count = static_cast<size_t>(std::distance(first, last));
+    return insert_nodes(iter, count, [&](Node* node) {
+      NodeTraits::construct(alloc_, node, *first);
+      ++first;
+    });
+  } else {
+    List temp(get_allocator());
+    for (; first != last; ++first) {
+      temp.emplace_back(*first);
+    }
+    iterator result = temp.begin();
+    if (temp.sz_ == 0) {
+      return iterator(const_cast<BaseNode*>(iter.ptr_));
+    }
+    splice(iter, temp);
+    return result;
+  }
+}
+
+template <typename T, typename Alloc>
+template <typename Construct>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert_nodes(const_iterator iter, size_t count, Construct construct) {
+  BaseNode* pos = const_cast<BaseNode*>(iter.ptr_);
+  if (count == 0) {
+    return iterator(pos);
+  }
+  Node* batch = nullptr;
+  if constexpr (is_monotonic<NodeAlloc>::value) {
+    batch = NodeTraits::allocate(alloc_, count);
+  }
+  BaseNode head;
+  BaseNode* tail = &head;
+  size_t built = 0;
+  try {
+    for (; built < count; built++) {
+      Node* node = batch != nullptr ? batch + built : NodeTraits::allocate(alloc_, 1);
+      try {
+        construct(node);
+      } catch (...) {
+        if (batch == nullptr) {
+          NodeTraits::deallocate(alloc_, node, 1);
+        }
+        throw;
+      }
+      tail->next = node;
+      node->prev = tail;
+      tail = node;
+    }
+  } catch (...) {
+    BaseNode* node = head.next;
+    for (; built != 0; built--) {
+      BaseNode* next = node->next;
+      NodeTraits::destroy(alloc_, static_cast<Node*>(node));
+      if (batch == nullptr) {
+        NodeTraits::deallocate(alloc_, static_cast<Node*>(node), 1);
+      }
+      node = next;
+    }
+    if (batch != nullptr) {
+      NodeTraits::deallocate(alloc_, batch, count);
+    }
+    throw;
+  }
+  BaseNode* prev = pos->prev;
+  prev->next = head.next;
+  head.next->prev = prev;
+  tail->next = pos;
+  pos->prev = tail;
+  sz_ += count;
+  return iterator(prev->next);
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::erase(const_iterator iter) {
+  BaseNode* next = iter.ptr_->next;
+  BaseNode* prev = iter.ptr_->prev;
+  Node* node = static_cast<Node*>(const_cast<BaseNode*>(iter.ptr_));
+  NodeTraits::destroy(alloc_, node);
+  NodeTraits::deallocate(alloc_, node, 1);
+  prev->next = next;
+  next->prev = prev;
+  sz_--;
+  return iterator(next);
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+typename List<T, Alloc>::iterator List<T, Alloc>::emplace(const_iterator iter, Args&&... args) {
+  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
+  BaseNode* prev = node->prev;
+  Node* new_node = NodeTraits::allocate(alloc_, 1);
+  try {
+    NodeTraits::construct(alloc_, new_node, std::forward<Args>(args)...);
+  } catch (...) {
+    NodeTraits::deallocate(alloc_, new_node, 1);
+    throw;
+  }
+  prev->next = static_cast<BaseNode*>(new_node);
+  new_node->prev = prev;
+  new_node->next = node;
+  node->prev = static_cast<BaseNode*>(new_node);
+  sz_++;
+  return iterator(static_cast<BaseNode*>(new_node));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::node_type& List<T, Alloc>::node_type::operator=(node_type&& other) {
+  if (this != &other) {
+    if (node_ != nullptr) {
+      NodeTraits::destroy(*alloc_, node_);
+      NodeTraits::deallocate(*alloc_, node_, 1);
+    }
+    node_ = other.node_;
+    alloc_ = std::move(other.alloc_);
+    other.node_ = nullptr;
+    other.alloc_.reset();
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc>::node_type::~node_type() {
+  if (node_ != nullptr) {
+    NodeTraits::destroy(*alloc_, node_);
+    NodeTraits::deallocate(*alloc_, node_, 1);
+  }
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, node_type&& handle) {
+  if (handle.empty()) {
+    return end();
+  }
+  bool same_allocator = true;
+  if constexpr (!NodeTraits::is_always_equal::value) {
+    same_allocator = (alloc_ == *handle.alloc_);
+  }
+  if (!same_allocator) {
+    iterator result = emplace(iter, std::move(handle.value()));
+    handle = node_type();
+    return result;
+  }
+  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
+  BaseNode* prev = node->prev;
+  Node* new_node = handle.node_;
+  prev->next = static_cast<BaseNode*>(new_node);
+  new_node->prev = prev;
+  new_node->next = node;
+  node->prev = static_cast<BaseNode*>(new_node);
+  sz_++;
+  handle.node_ = nullptr;
+  handle.alloc_.reset();
+  return iterator(static_cast<BaseNode*>(new_node));
+}
+
+template <typename T, typename Alloc>
+typename List<T, Alloc>::node_type List<T, Alloc>::extract(const_iterator iter) {
+  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = nullptr;
+  node->next = nullptr;
+  sz_--;
+  return node_type(static_cast<Node*>(node), alloc_);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::clear() {
+  while (sz_ != 0) {
+    pop_back();
+  }
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::swap(List& other) {
+  if constexpr (NodeTraits::propagate_on_container_swap::value) {
+    std::swap(alloc_, other.alloc_);
+  }
+  swap_nodes(other);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List& other) {
+  if (&other == this || other.sz_ == 0) {
+    return;
+  }
+  if (!allocator_equal(other)) {
+    List temp = take_range(other, other.begin(), other.end());
+    splice(pos, temp);
+    return;
+  }
+  sz_ += other.sz_;
+  other.sz_ = 0;
+  transfer(const_cast<BaseNode*>(pos.ptr_), other.fake_node_.next, &other.fake_node_);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List&& other) {
+  splice(pos, other);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List& other, const_iterator iter) {
+  const_iterator next = iter;
+  splice(pos, other, iter, ++next);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List&& other, const_iterator iter) {
+  splice(pos, other, iter);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List& other, const_iterator first, const_iterator last) {
+  if (first == last || pos == first || pos == last) {
+    return;
+  }
+  if (!allocator_equal(other)) {
+    List temp = take_range(other, first, last);
+    splice(pos, temp);
+    return;
+  }
+  if (&other != this) {
+    size_t count = std::distance(first, last);
+    sz_ += count;
+    other.sz_ -= count;
+  }
+  transfer(const_cast<BaseNode*>(pos.ptr_), const_cast<BaseNode*>(first.ptr_), const_cast<BaseNode*>(last.ptr_));
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::splice(const_iterator pos, List&& other, const_iterator first, const_iterator last) {
+  splice(pos, other, first, last);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::merge(List& other) {
+  merge(other, std::less<>());
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::merge(List&& other) {
+  merge(other, std::less<>());
+}
+
+template <typename T, typename Alloc>
+template <typename Compare>
+void List<T, Alloc>::merge(List& other, Compare comp) {
+  if (&other == this) {
+    return;
+  }
+  if (!allocator_equal(other)) {
+    List temp = take_range(other, other.begin(), other.end());
+    merge(temp, comp);
+    return;
+  }
+  BaseNode* first = fake_node_.next;
+  BaseNode* other_first = other.fake_node_.next;
+  while (first != &fake_node_ && other_first != &other.fake_node_) {
+    if (comp(static_cast<Node*>(other_first)->value, static_cast<Node*>(first)->value)) {
+      BaseNode* next = other_first->next;
+      transfer(first, other_first, next);
+      other_first = next;
+      ++sz_;
+      --other.sz_;
+    } else {
+      first = first->next;
+    }
+  }
+  if (other_first != &other.fake_node_) {
+    transfer(&fake_node_, other_first, &other.fake_node_);
+    sz_ += other.sz_;
+    other.sz_ = 0;
+  }
+}
+
+template <typename T, typename Alloc>
+template <typename Compare>
+void List<T, Alloc>::merge(List&& other, Compare comp) {
+  merge(other, comp);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::sort() {
+  sort(std::less<>());
+}
+
+template <typename T, typename Alloc>
+template <typename Compare>
+void List<T, Alloc>::sort(Compare comp) {
+  if (sz_ < 2) {
+    return;
+  }
+  BaseNode* runs[64] = {};
+  BaseNode* carry = nullptr;
+  BaseNode* node = fake_node_.next;
+  fake_node_.prev->next = nullptr;
+  try {
+    while (node != nullptr) {
+      carry = node;
+      node = node->next;
+      carry->next = nullptr;
+      size_t i = 0;
+      for (; runs[i] != nullptr; ++i) {
+        BaseNode* run = carry;
+        carry = nullptr;
+        merge_runs(runs[i], run, comp);
+        carry = runs[i];
+        runs[i] = nullptr;
+      }
+      runs[i] = carry;
+      carry = nullptr;
+    }
+    for (size_t i = 1; i < 64; ++i) {
+      BaseNode* run = runs[i - 1];
+      runs[i - 1] = nullptr;
+      merge_runs(runs[i], run, comp);
+    }
+  } catch (...) {
+    BaseNode* prev = &fake_node_;
+    for (BaseNode* chain : {carry, node}) {
+      for (; chain != nullptr; chain = chain->next) {
+        prev->next = chain;
+        chain->prev = prev;
+        prev = chain;
+      }
+    }
+    for (BaseNode* chain : runs) {
+      for (; chain != nullptr; chain = chain->next) {
+        prev->next = chain;
+        chain->prev = prev;
+        prev = chain;
+      }
+    }
+    prev->next = &fake_node_;
+    fake_node_.prev = prev;
+    throw;
+  }
+  BaseNode* prev = &fake_node_;
+  for (node = runs[63]; node != nullptr; node = node->next) {
+    prev->next = node;
+    node->prev = prev;
+    prev = node;
+  }
+  prev->next = &fake_node_;
+  fake_node_.prev = prev;
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::compact() {
+  if (sz_ == 0) {
+    return;
+  }
+  std::vector<Node*> nodes;
+  Node* batch = nullptr;
+  if constexpr (is_monotonic<NodeAlloc>::value) {
+    batch = NodeTraits::allocate(alloc_, sz_);
+  } else {
+    nodes.reserve(sz_);
+    try {
+      while (nodes.size() < sz_) {
+        nodes.push_back(NodeTraits::allocate(alloc_, 1));
+      }
+    } catch (...) {
+      for (Node* node : nodes) {
+        NodeTraits::deallocate(alloc_, node, 1);
+      }
+      throw;
+    }
+    std::sort(nodes.begin(), nodes.end(), std::less<Node*>());
+  }
+  auto new_node = [&](size_t index) -> Node* { return batch != nullptr ? batch + index : nodes[index]; };
+  size_t built = 0;
+  try {
+    for (BaseNode* old = fake_node_.next; old != &fake_node_; old = old->next) {
+      NodeTraits::construct(alloc_, new_node(built), std::move_if_noexcept(static_cast<Node*>(old)->value));
+      built++;
+    }
+  } catch (...) {
+    for (size_t i = 0; i < built; i++) {
+      NodeTraits::destroy(alloc_, new_node(i));
+    }
+    if (batch != nullptr) {
+      NodeTraits::deallocate(alloc_, batch, sz_);
+    } else {
+      for (Node* node : nodes) {
+        NodeTraits::deallocate(alloc_, node, 1);
+      }
+    }
+    throw;
+  }
+  BaseNode* old = fake_node_.next;
+  while (old != &fake_node_) {
+    BaseNode* next = old->next;
+    NodeTraits::destroy(alloc_, static_cast<Node*>(old));
+    NodeTraits::deallocate(alloc_, static_cast<Node*>(old), 1);
+    old = next;
+  }
+  BaseNode* prev = &fake_node_;
+  for (size_t i = 0; i < sz_; i++) {
+    Node* node = new_node(i);
+    prev->next = node;
+    node->prev = prev;
+    prev = node;
+  }
+  prev->next = &fake_node_;
+  fake_node_.prev = prev;
+}
+
+template <typename T, typename Alloc>
+bool List<T, Alloc>::allocator_equal(List& other) {
+  if constexpr (NodeTraits::is_always_equal::value) {
+    return true;
+  } else {
+    return alloc_ == other.alloc_;
+  }
+}
+
+template <typename T, typename Alloc>
+List<T, Alloc> List<T, Alloc>::take_range(List& other, const_iterator first, const_iterator last) {
+  List result(get_allocator());
+  while (first != last) {
+    result.push_back(std::move(static_cast<Node*>(const_cast<BaseNode*>(first.ptr_))->value));
+    first = other.erase(first);
+  }
+  return result;
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::transfer(BaseNode* pos, BaseNode* first, BaseNode* last) {
+  BaseNode* before_last = last->prev;
+  first->prev->next = last;
+  last->prev = first->prev;
+  BaseNode* prev = pos->prev;
+  prev->next = first;
+  first->prev = prev;
+  before_last->next = pos;
+  pos->prev = before_last;
+}
+
+template <typename T, typename Alloc>
+template <typename Compare>
+void List<T, Alloc>::merge_runs(BaseNode*& first, BaseNode* second, Compare& comp) {
+  BaseNode head;
+  BaseNode* tail = &head;
+  try {
+    while (first != nullptr && second != nullptr) {
+      if (comp(static_cast<Node*>(second)->value, static_cast<Node*>(first)->value)) {
+        tail->next = second;
+        second = second->next;
+      } else {
+        tail->next = first;
+        first = first->next;
+      }
+      tail = tail->next;
+    }
+  } catch (...) {
+    tail->next = first;
+    while (tail->next != nullptr) {
+      tail = tail->next;
+    }
+    tail->next = second;
+    first = head.next;
+    throw;
+  }
+  tail->next = first != nullptr ? first : second;
+  first = head.next;
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
+class UnrolledList {
+
+  using BaseNode = ListBaseNode;
+
+  static const size_t node_bytes = 256;
+  static const size_t header_bytes = 2 * sizeof(BaseNode*) + sizeof(size_t);
+  static const size_t size_of_cluster = sizeof(T) + header_bytes < node_bytes ? (node_bytes - header_bytes) / sizeof(T) : 1;
+
+  static_assert(std::is_nothrow_move_constructible_v<T>);
+
+  struct alignas(64) Node: BaseNode {
+    size_t count = 0;
+    alignas(T) char buffer[size_of_cluster * sizeof(T)];
+
+    T* values() { return reinterpret_cast<T*>(buffer); }
+
+    const T* values() const { return reinterpret_cast<const T*>(buffer); }
+  };
+
+  using NodeAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  [[no_unique_address]] NodeAlloc alloc_;
+  BaseNode fake_node_ = {&fake_node_, &fake_node_};
+  size_t sz_ = 0;
+
+public:
+  UnrolledList();
+
+  UnrolledList(const Alloc&);
+
+  UnrolledList(const UnrolledList&);
+
+  UnrolledList(UnrolledList&&);
+
+  UnrolledList& operator=(const UnrolledList&);
+
+  UnrolledList& operator=(UnrolledList&&);
+
+  ~UnrolledList();
+
+  Alloc get_allocator() const;
+
+  size_t size() const;
+
+  void clear();
+
+  void push_back(const T&);
+
+  void push_back(T&&);
+
+  void push_front(const T&);
+
+  void push_front(T&&);
+
+  void pop_back();
+
+  void pop_front();
+
+  template <bool is_const>
+  class common_iterator {
+  public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<is_const, const T&, T&>;
+    using pointer = std::conditional_t<is_const, const T*, T*>;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+  private:
+    using basenode_pointer = std::conditional_t<is_const, const BaseNode*, BaseNode*>;
+    using node_pointer = std::conditional_t<is_const, const Node*, Node*>;
+
+    basenode_pointer ptr_;
+    size_t index_;
+
+  public:
+    common_iterator() = default;
+
+    common_iterator(const common_iterator &other) = default;
+
+    common_iterator(basenode_pointer ptr, size_t index) : ptr_(ptr), index_(index) {}
+
+    common_iterator& operator=(const common_iterator& other) = default;
+
+    operator common_iterator<true>() const {
+      return common_iterator<true>(ptr_, index_);
+    }
+
+    common_iterator& operator++();
+
+    common_iterator operator++(int);
+
+    common_iterator& operator--();
+
+    common_iterator operator--(int);
+
+    bool operator==(const common_iterator&) const;
+
+    bool operator!=(const common_iterator&) const;
+
+    reference operator*() const;
+
+    pointer operator->() const;
+
+    friend class UnrolledList;
+  };
+
+  using iterator = common_iterator<false>;
+  using const_iterator = common_iterator<true>;
+
+  iterator begin();
+
+  const_iterator begin() const;
+
+  const_iterator cbegin() const;
+
+  iterator end();
+
+  const_iterator end() const;
+
+  const_iterator cend() const;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  reverse_iterator rbegin();
+
+  const_reverse_iterator rbegin() const;
+
+  const_reverse_iterator crbegin() const;
+
+  reverse_iterator rend();
+
+  const_reverse_iterator rend() const;
+
+  const_reverse_iterator crend() const;
+
+  iterator insert(const_iterator, const T&);
+
+  iterator insert(const_iterator, T&&);
+
+  iterator erase(const_iterator);
+
+  void swap(UnrolledList&);
+
+private:
+  template <typename... Args>
+  iterator emplace(const_iterator, Args&&...);
+
+  Node* insert_node(BaseNode*);
+
+  void erase_node(Node*);
+
+  void move_last_to(Node*, size_t);
+
+  void append_values(Node*, Node*);
+};
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>::UnrolledList() : UnrolledList(Alloc()) {}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>::UnrolledList(const Alloc& alloc) : alloc_(alloc) {}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>::UnrolledList(const UnrolledList& other) : alloc_(NodeTraits::select_on_container_copy_construction(other.alloc_)) {
+  try {
+    for (const T& value : other) {
+      push_back(value);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>::UnrolledList(UnrolledList&& other) : alloc_(std::move(other.alloc_)) {
+  swap(other);
+}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>& UnrolledList<T, Alloc>::operator=(const UnrolledList& other) {
+  if (this == &other) {
+    return *this;
+  }
+  clear();
+  if constexpr (NodeTraits::propagate_on_container_copy_assignment::value) {
+    alloc_ = other.alloc_;
+  }
+  for (const T& value : other) {
+    push_back(value);
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>& UnrolledList<T, Alloc>::operator=(UnrolledList&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  clear();
+  if constexpr (NodeTraits::propagate_on_container_move_assignment::value) {
+    alloc_ = std::move(other.alloc_);
+  }
+  swap(other);
+  return *this;
+}
+
+template <typename T, typename Alloc>
+UnrolledList<T, Alloc>::~UnrolledList() {
+  clear();
+}
+
+template <typename T, typename Alloc>
+Alloc UnrolledList<T, Alloc>::get_allocator() const { return typename NodeTraits:: template rebind_alloc<T>(alloc_); }
+
+template <typename T, typename Alloc>
+size_t UnrolledList<T, Alloc>::size() const { return sz_; }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::clear() {
+  while (fake_node_.next != &fake_node_) {
+    Node* node = static_cast<Node*>(fake_node_.next);
+    for (size_t i = 0; i < node->count; ++i) {
+      NodeTraits::destroy(alloc_, node->values() + i);
+    }
+    sz_ -= node->count;
+    erase_node(node);
+  }
+}
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::push_back(const T& value) { insert(end(), value); }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::push_back(T&& value) { insert(end(), std::move(value)); }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::push_front(const T& value) { insert(begin(), value); }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::push_front(T&& value) { insert(begin(), std::move(value)); }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::pop_back() { erase(--end()); }
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::pop_front() { erase(begin()); }
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const>& UnrolledList<T, Alloc>::common_iterator<is_const>::operator++() {
+  if (++index_ == static_cast<node_pointer>(ptr_)->count) {
+    ptr_ = ptr_->next;
+    index_ = 0;
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const> UnrolledList<T, Alloc>::common_iterator<is_const>::operator++(int) {
+  common_iterator<is_const> temp = *this;
+  ++*this;
+  return temp;
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const>& UnrolledList<T, Alloc>::common_iterator<is_const>::operator--() {
+  if (index_ == 0) {
+    ptr_ = ptr_->prev;
+    index_ = static_cast<node_pointer>(ptr_)->count;
+  }
+  --index_;
+  return *this;
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const> UnrolledList<T, Alloc>::common_iterator<is_const>::operator--(int) {
+  common_iterator<is_const> temp = *this;
+  --*this;
+  return temp;
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+bool UnrolledList<T, Alloc>::common_iterator<is_const>::operator==(const common_iterator& other) const {
+  return ptr_ == other.ptr_ && index_ == other.index_;
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+bool UnrolledList<T, Alloc>::common_iterator<is_const>::operator!=(const common_iterator& other) const {
+  return !(*this == other);
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const>::reference UnrolledList<T, Alloc>::common_iterator<is_const>::operator*() const {
+  return static_cast<node_pointer>(ptr_)->values()[index_];
+}
+
+template <typename T, typename Alloc>
+template <bool is_const>
+typename UnrolledList<T, Alloc>:: template common_iterator<is_const>::pointer UnrolledList<T, Alloc>::common_iterator<is_const>::operator->() const {
+  return static_cast<node_pointer>(ptr_)->values() + index_;
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::begin() {
+  return iterator(fake_node_.next, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_iterator UnrolledList<T, Alloc>::begin() const {
+  return const_iterator(fake_node_.next, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_iterator UnrolledList<T, Alloc>::cbegin() const {
+  return const_iterator(fake_node_.next, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::end() {
+  return iterator(&fake_node_, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_iterator UnrolledList<T, Alloc>::end() const {
+  return const_iterator(&fake_node_, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_iterator UnrolledList<T, Alloc>::cend() const {
+  return const_iterator(&fake_node_, 0);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::reverse_iterator UnrolledList<T, Alloc>::rbegin() {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_reverse_iterator UnrolledList<T, Alloc>::rbegin() const {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_reverse_iterator UnrolledList<T, Alloc>::crbegin() const {
+  return std::make_reverse_iterator(cend());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::reverse_iterator UnrolledList<T, Alloc>::rend() {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_reverse_iterator UnrolledList<T, Alloc>::rend() const {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::const_reverse_iterator UnrolledList<T, Alloc>::crend() const {
+  return std::make_reverse_iterator(cbegin());
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::insert(const_iterator iter, const T& value) {
+  return emplace(iter, value);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::insert(const_iterator iter, T&& value) {
+  return emplace(iter, std::move(value));
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::erase(const_iterator iter) {
+  Node* node = static_cast<Node*>(const_cast<BaseNode*>(iter.ptr_));
+  size_t index = iter.index_;
+  T* values = node->values();
+  NodeTraits::destroy(alloc_, values + index);
+  for (size_t i = index + 1; i < node->count; ++i) {
+    NodeTraits::construct(alloc_, values + i - 1, std::move(values[i]));
+    NodeTraits::destroy(alloc_, values + i);
+  }
+  --node->count;
+  --sz_;
+  if (node->count == 0) {
+    BaseNode* next = node->next;
+    erase_node(node);
+    return iterator(next, 0);
+  }
+  if (node->count < size_of_cluster / 2) {
+    Node* next = static_cast<Node*>(node->next);
+    Node* prev = static_cast<Node*>(node->prev);
+    if (node->next != &fake_node_ && node->count + next->count <= size_of_cluster) {
+      append_values(next, node);
+      erase_node(next);
+    } else if (node->prev != &fake_node_ && prev->count + node->count <= size_of_cluster) {
+      index += prev->count;
+      append_values(node, prev);
+      erase_node(node);
+      node = prev;
+    }
+  }
+  if (index == node->count) {
+    return iterator(node->next, 0);
+  }
+  return iterator(node, index);
+}
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::swap(UnrolledList& other) {
+  if constexpr (NodeTraits::propagate_on_container_swap::value) {
+    std::swap(alloc_, other.alloc_);
+  }
+  std::swap(fake_node_, other.fake_node_);
+  ListBaseNode::relink_fake_node(fake_node_, other.fake_node_);
+  ListBaseNode::relink_fake_node(other.fake_node_, fake_node_);
+  std::swap(sz_, other.sz_);
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+typename UnrolledList<T, Alloc>::iterator UnrolledList<T, Alloc>::emplace(const_iterator iter, Args&&... args) {
+  BaseNode* base = const_cast<BaseNode*>(iter.ptr_);
+  size_t index = iter.index_;
+  if (base != &fake_node_ && static_cast<Node*>(base)->count == size_of_cluster && index != 0) {
+    Node* left = static_cast<Node*>(base);
+    Node* right = insert_node(left->next);
+    size_t half = size_of_cluster / 2;
+    try {
+      NodeTraits::construct(alloc_, right->values() + size_of_cluster - half, std::forward<Args>(args)...);
+    } catch (...) {
+      erase_node(right);
+      throw;
+    }
+    for (size_t i = half; i < size_of_cluster; ++i) {
+      NodeTraits::construct(alloc_, right->values() + i - half, std::move(left->values()[i]));
+      NodeTraits::destroy(alloc_, left->values() + i);
+    }
+    left->count = half;
+    right->count = size_of_cluster - half + 1;
+    ++sz_;
+    if (index > half) {
+      move_last_to(right, index - half);
+      return iterator(right, index - half);
+    }
+    NodeTraits::construct(alloc_, left->values() + half, std::move(right->values()[size_of_cluster - half]));
+    NodeTraits::destroy(alloc_, right->values() + size_of_cluster - half);
+    --right->count;
+    ++left->count;
+    move_last_to(left, index);
+    return iterator(left, index);
+  }
+  Node* node = nullptr;
+  bool fresh = false;
+  if (base == &fake_node_ || static_cast<Node*>(base)->count == size_of_cluster) {
+    if (base->prev != &fake_node_ && static_cast<Node*>(base->prev)->count < size_of_cluster) {
+      node = static_cast<Node*>(base->prev);
+      index = node->count;
+    } else {
+      node = insert_node(base);
+      index = 0;
+      fresh = true;
+    }
+  } else {
+    node = static_cast<Node*>(base);
+  }
+  try {
+    NodeTraits::construct(alloc_, node->values() + node->count, std::forward<Args>(args)...);
+  } catch (...) {
+    if (fresh) {
+      erase_node(node);
+    }
+    throw;
+  }
+  ++node->count;
+  ++sz_;
+  move_last_to(node, index);
+  return iterator(node, index);
+}
+
+template <typename T, typename Alloc>
+typename UnrolledList<T, Alloc>::Node* UnrolledList<T, Alloc>::insert_node(BaseNode* next) {
+  Node* node = NodeTraits::allocate(alloc_, 1);
+  NodeTraits::construct(alloc_, node);
+  BaseNode* prev = next->prev;
+  prev->next = node;
+  node->prev = prev;
+  node->next = next;
+  next->prev = node;
+  return node;
+}
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::erase_node(Node* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  NodeTraits::destroy(alloc_, node);
+  NodeTraits::deallocate(alloc_, node, 1);
+}
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::move_last_to(Node* node, size_t index) {
+  T* values = node->values();
+  size_t last = node->count - 1;
+  if (index == last) {
+    return;
+  }
+  T value(std::move(values[last]));
+  NodeTraits::destroy(alloc_, values + last);
+  for (size_t i = last; i > index; --i) {
+    NodeTraits::construct(alloc_, values + i, std::move(values[i - 1]));
+    NodeTraits::destroy(alloc_, values + i - 1);
+  }
+  NodeTraits::construct(alloc_, values + index, std::move(value));
+}
+
+template <typename T, typename Alloc>
+void UnrolledList<T, Alloc>::append_values(Node* from, Node* to) {
+  for (size_t i = 0; i < from->count; ++i) {
+    NodeTraits::construct(alloc_, to->values() + to->count + i, std::move(from->values()[i]));
+    NodeTraits::destroy(alloc_, from->values() + i);
+  }
+  to->count += from->count;
+  from->count = 0;
+}
+
+
+
+struct ListHook : ListBaseNode {
+  ListHook() = default;
+
+  ListHook(const ListHook&) : ListBaseNode() {}
+
+  ListHook& operator=(const ListHook&) { return *this; }
+
+  bool is_linked() const { return next != nullptr; }
+};
+
+template <typename T, ListHook T::* Hook>
+class IntrusiveList {
+  using BaseNode = ListBaseNode;
+
+  BaseNode fake_node_ = {&fake_node_, &fake_node_};
+  size_t sz_ = 0;
+
+public:
+  using value_type = T;
+
+  IntrusiveList();
+
+  IntrusiveList(const IntrusiveList&) = delete;
+
+  IntrusiveList(IntrusiveList&&);
+
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  IntrusiveList& operator=(IntrusiveList&&);
+
+  ~IntrusiveList();
+
+  size_t size() const;
+
+  bool empty() const;
+
+  T& front();
+
+  T& back();
+
+  void push_back(T&);
+
+  void push_front(T&);
+
+  void pop_back();
+
+  void pop_front();
+
+  template <bool is_const>
+  using common_iterator = ListIterator<IntrusiveList, is_const>;
+
+  using iterator = common_iterator<false>;
+  using const_iterator = common_iterator<true>;
+
+  iterator begin();
+
+  const_iterator begin() const;
+
+  const_iterator cbegin() const;
+
+  iterator end();
+
+  const_iterator end() const;
+
+  const_iterator cend() const;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  reverse_iterator rbegin();
+
+  const_reverse_iterator rbegin() const;
+
+  reverse_iterator rend();
+
+  const_reverse_iterator rend() const;
+
+  static iterator iterator_to(T&);
+
+  static const_iterator iterator_to(const T&);
+
+  iterator insert(const_iterator, T&);
+
+  iterator erase(const_iterator);
+
+  void remove(T&);
+
+  void clear();
+
+  void swap(IntrusiveList&);
+
+  void splice(const_iterator, IntrusiveList&, const_iterator);
+
+  void splice(const_iterator, IntrusiveList&);
+
+private:
+  static std::ptrdiff_t hook_offset();
+
+  static T* value_of(BaseNode*);
+
+  static const T* value_of(const BaseNode*);
+
+  template <typename, bool>
+  friend class ListIterator;
+};
+
+template <typename T, ListHook T::* Hook>
+IntrusiveList<T, Hook>::IntrusiveList() {}
+
+template <typename T, ListHook T::* Hook>
+IntrusiveList<T, Hook>::IntrusiveList(IntrusiveList&& other) : IntrusiveList() {
+  swap(other);
+}
+
+template <typename T, ListHook T::* Hook>
+IntrusiveList<T, Hook>& IntrusiveList<T, Hook>::operator=(IntrusiveList&& other) {
+  clear();
+  swap(other);
+  return *this;
+}
+
+template <typename T, ListHook T::* Hook>
+IntrusiveList<T, Hook>::~IntrusiveList() {
+  clear();
+}
+
+template <typename T, ListHook T::* Hook>
+size_t IntrusiveList<T, Hook>::size() const {
+  return sz_;
+}
+
+template <typename T, ListHook T::* Hook>
+bool IntrusiveList<T, Hook>::empty() const {
+  return sz_ == 0;
+}
+
+template <typename T, ListHook T::* Hook>
+T& IntrusiveList<T, Hook>::front() {
+  return *value_of(fake_node_.next);
+}
+
+template <typename T, ListHook T::* Hook>
+T& IntrusiveList<T, Hook>::back() {
+  return *value_of(fake_node_.prev);
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::push_back(T& value) {
+  insert(end(), value);
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::push_front(T& value) {
+  insert(begin(), value);
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::pop_back() {
+  erase(--end());
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::pop_front() {
+  erase(begin());
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::begin() {
+  return iterator(fake_node_.next);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_iterator IntrusiveList<T, Hook>::begin() const {
+  return const_iterator(fake_node_.next);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_iterator IntrusiveList<T, Hook>::cbegin() const {
+  return const_iterator(fake_node_.next);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::end() {
+  return iterator(&fake_node_);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_iterator IntrusiveList<T, Hook>::end() const {
+  return const_iterator(&fake_node_);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_iterator IntrusiveList<T, Hook>::cend() const {
+  return const_iterator(&fake_node_);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::reverse_iterator IntrusiveList<T, Hook>::rbegin() {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_reverse_iterator IntrusiveList<T, Hook>::rbegin() const {
+  return std::make_reverse_iterator(end());
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::reverse_iterator IntrusiveList<T, Hook>::rend() {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_reverse_iterator IntrusiveList<T, Hook>::rend() const {
+  return std::make_reverse_iterator(begin());
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::iterator_to(T& value) {
+  return iterator(&(value.*Hook));
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::const_iterator IntrusiveList<T, Hook>::iterator_to(const T& value) {
+  return const_iterator(&(value.*Hook));
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::insert(const_iterator iter, T& value) {
+  assert(!(value.*Hook).is_linked());
+  BaseNode* node = &(value.*Hook);
+  BaseNode::link(const_cast<BaseNode*>(iter.ptr_), node);
+  sz_++;
+  return iterator(node);
+}
+
+template <typename T, ListHook T::* Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::erase(const_iterator iter) {
+  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
+  BaseNode* next = node->next;
+  BaseNode::unlink(node);
+  sz_--;
+  return iterator(next);
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::remove(T& value) {
+  erase(iterator_to(value));
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::clear() {
+  BaseNode* node = fake_node_.next;
+  while (node != &fake_node_) {
+    BaseNode* next = node->next;
+    node->prev = nullptr;
+    node->next = nullptr;
+    node = next;
+  }
+  fake_node_.prev = &fake_node_;
+  fake_node_.next = &fake_node_;
+  sz_ = 0;
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::swap(IntrusiveList& other) {
+  std::swap(fake_node_.prev, other.fake_node_.prev);
+  std::swap(fake_node_.next, other.fake_node_.next);
+  ListBaseNode::relink_fake_node(fake_node_, other.fake_node_);
+  ListBaseNode::relink_fake_node(other.fake_node_, fake_node_);
+  std::swap(sz_, other.sz_);
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::splice(const_iterator pos, IntrusiveList& other, const_iterator iter) {
+  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
+  BaseNode* next = const_cast<BaseNode*>(pos.ptr_);
+  if (node == next || node->next == next) {
+    return;
+  }
+  BaseNode::unlink(node);
+  BaseNode::link(next, node);
+  other.sz_--;
+  sz_++;
+}
+
+template <typename T, ListHook T::* Hook>
+void IntrusiveList<T, Hook>::splice(const_iterator pos, IntrusiveList& other) {
+  if (&other == this || other.sz_ == 0) {
+    return;
+  }
+  BaseNode* next = const_cast<BaseNode*>(pos.ptr_);
+  BaseNode* prev = next->prev;
+  prev->next = other.fake_node_.next;
+  other.fake_node_.next->prev = prev;
+  next->prev = other.fake_node_.prev;
+  other.fake_node_.prev->next = next;
+  sz_ += other.sz_;
+  other.fake_node_.prev = &other.fake_node_;
+  other.fake_node_.next = &other.fake_node_;
+  other.sz_ = 0;
+}
+
+template <typename T, ListHook T::* Hook>
+std::ptrdiff_t IntrusiveList<T, Hook>::hook_offset() {
+  using Offset = std::conditional_t<sizeof(ListHook T::*) == sizeof(int32_t), int32_t, std::ptrdiff_t>;
+  static_assert(sizeof(ListHook T::*) == sizeof(Offset));
+  ListHook T::* hook = Hook;
+  Offset offset;
+  std::memcpy(&offset, &hook, sizeof(offset));
+  return offset;
+}
+
+template <typename T, ListHook T::* Hook>
+T* IntrusiveList<T, Hook>::value_of(BaseNode* node) {
+  return reinterpret_cast<T*>(reinterpret_cast<char*>(static_cast<ListHook*>(node)) - hook_offset());
+}
+
+template <typename T, ListHook T::* Hook>
+const T* IntrusiveList<T, Hook>::value_of(const BaseNode* node) {
+  return value_of(const_cast<BaseNode*>(node));
+}
+
+template <typename Handle, typename Alloc>
+class CacheIndex {
+  struct Slot {
+    size_t hash = 0;
+    Handle handle = Handle();
+    bool used = false;
+  };
+
+  using SlotAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<Slot>;
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  std::vector<Slot, SlotAlloc> slots_;
+  size_t mask_;
+
+  static size_t mix(size_t hash) {
+    hash ^= hash >> 33;
+    hash *= static_cast<size_t>(0xff51afd7ed558ccdULL);
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  static size_t table_size(size_t max_size) {
+    size_t size = 8;
+    while (size < 2 * max_size) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  template <typename Match>
+  size_t lookup(size_t hash, Match& match) const {
+    for (size_t i = hash & mask_; slots_[i].used; i = (i + 1) & mask_) {
+      if (slots_[i].hash == hash && match(slots_[i].handle)) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+public:
+  CacheIndex(size_t max_size, const Alloc& alloc) : slots_(table_size(max_size), Slot(), SlotAlloc(alloc)), mask_(slots_.size() - 1) {}
+
+  template <typename Match>
+  Handle* find(size_t hash, Match match) {
+    size_t i = lookup(mix(hash), match);
+    return i == npos ? nullptr : &slots_[i].handle;
+  }
+
+  template <typename Match>
+  const Handle* find(size_t hash, Match match) const {
+    size_t i = lookup(mix(hash), match);
+    return i == npos ? nullptr : &slots_[i].handle;
+  }
+
+  void insert(size_t hash, const Handle& handle) {
+    hash = mix(hash);
+    size_t i = hash & mask_;
+    while (slots_[i].used) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i].hash = hash;
+    slots_[i].handle = handle;
+    slots_[i].used = true;
+  }
+
+  template <typename Match>
+  bool erase(size_t hash, Match match) {
+    size_t i = lookup(mix(hash), match);
+    if (i == npos) {
+      return false;
+    }
+    for (size_t j = (i + 1) & mask_; slots_[j].used; j = (j + 1) & mask_) {
+      size_t home = slots_[j].hash & mask_;
+      if (((j - home) & mask_) >= ((j - i) & mask_)) {
+        slots_[i] = slots_[j];
+        i = j;
+      }
+    }
+    slots_[i].used = false;
+    return true;
+  }
+
+  void clear() {
+    for (Slot& slot : slots_) {
+      slot.used = false;
+    }
+  }
+};
+
+template <typename K, typename V, typename Alloc = std::allocator<std::pair<K, V>>, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class LruCache {
+  using Entries = List<std::pair<K, V>, Alloc>;
+  using Handle = typename Entries::iterator;
+
+  Entries entries_;
+  CacheIndex<Handle, Alloc> index_;
+  size_t capacity_;
+  [[no_unique_address]] Hash hash_;
+  [[no_unique_address]] KeyEqual equal_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  size_t evictions_ = 0;
+
+public:
+  explicit LruCache(size_t, const Alloc& = Alloc());
+
+  LruCache(const LruCache&) = delete;
+
+  LruCache& operator=(const LruCache&) = delete;
+
+  size_t size() const;
+
+  size_t capacity() const;
+
+  V* get(const K&);
+
+  bool contains(const K&) const;
+
+  V& put(const K&, V);
+
+  bool erase(const K&);
+
+  void clear();
+
+  size_t hits() const;
+
+  size_t misses() const;
+
+  size_t evictions() const;
+
+  void reset_stats();
+
+private:
+  Handle* find(const K&, size_t);
+};
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+LruCache<K, V, Alloc, Hash, KeyEqual>::LruCache(size_t capacity, const Alloc& alloc) : entries_(alloc), index_(capacity, alloc), capacity_(capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("LruCache capacity must be positive");
+  }
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Alloc, Hash, KeyEqual>::size() const {
+  return entries_.size();
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Alloc, Hash, KeyEqual>::capacity() const {
+  return capacity_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+V* LruCache<K, V, Alloc, Hash, KeyEqual>::get(const K& key) {
+  Handle* handle = find(key, hash_(key));
+  if (handle == nullptr) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  entries_.splice(entries_.begin(), entries_, *handle);
+  return &(*handle)->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Alloc, Hash, KeyEqual>::contains(const K& key) const {
+  return index_.find(hash_(key), [&](const Handle& handle) { return equal_(handle->first, key); }) != nullptr;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+V& LruCache<K, V, Alloc, Hash, KeyEqual>::put(const K& key, V value) {
+  size_t hash = hash_(key);
+  if (Handle* handle = find(key, hash)) {
+    (*handle)->second = std::move(value);
+    entries_.splice(entries_.begin(), entries_, *handle);
+    return (*handle)->second;
+  }
+  if (entries_.size() == capacity_) {
+    Handle victim = std::prev(entries_.end());
+    index_.erase(hash_(victim->first), [&](const Handle& handle) { return handle == victim; });
+    evictions_++;
+    try {
+      victim->first = key;
+      victim->second = std::move(value);
+    } catch (...) {
+      entries_.erase(victim);
+      throw;
+    }
+    entries_.splice(entries_.begin(), entries_, victim);
+  } else {
+    entries_.emplace_front(key, std::move(value));
+  }
+  index_.insert(hash, entries_.begin());
+  return entries_.begin()->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Alloc, Hash, KeyEqual>::erase(const K& key) {
+  Handle* handle = find(key, hash_(key));
+  if (handle == nullptr) {
+    return false;
+  }
+  Handle entry = *handle;
+  index_.erase(hash_(key), [&](const Handle& other) { return other == entry; });
+  entries_.erase(entry);
+  return true;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LruCache<K, V, Alloc, Hash, KeyEqual>::clear() {
+  index_.clear();
+  entries_.clear();
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Alloc, Hash, KeyEqual>::hits() const {
+  return hits_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Alloc, Hash, KeyEqual>::misses() const {
+  return misses_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Alloc, Hash, KeyEqual>::evictions() const {
+  return evictions_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LruCache<K, V, Alloc, Hash, KeyEqual>::reset_stats() {
+  hits_ = 0;
+  misses_ = 0;
+  evictions_ = 0;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+typename LruCache<K, V, Alloc, Hash, KeyEqual>::Handle* LruCache<K, V, Alloc, Hash, KeyEqual>::find(const K& key, size_t hash) {
+  return index_.find(hash, [&](const Handle& handle) { return equal_(handle->first, key); });
+}
+
+template <typename K, typename V, typename Alloc = std::allocator<std::pair<K, V>>, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class LfuCache {
+  using Entries = List<std::pair<K, V>, Alloc>;
+
+  struct Bucket {
+    size_t frequency;
+    Entries entries;
+
+    Bucket(size_t frequency, const Alloc& alloc) : frequency(frequency), entries(alloc) {}
+  };
+
+  using BucketAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<Bucket>;
+  using Buckets = List<Bucket, BucketAlloc>;
+
+  struct Handle {
+    typename Entries::iterator entry;
+    typename Buckets::iterator bucket;
+  };
+
+  Alloc alloc_;
+  Buckets buckets_;
+  CacheIndex<Handle, Alloc> index_;
+  size_t capacity_;
+  size_t size_ = 0;
+  [[no_unique_address]] Hash hash_;
+  [[no_unique_address]] KeyEqual equal_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  size_t evictions_ = 0;
+
+public:
+  explicit LfuCache(size_t, const Alloc& = Alloc());
+
+  LfuCache(const LfuCache&) = delete;
+
+  LfuCache& operator=(const LfuCache&) = delete;
+
+  size_t size() const;
+
+  size_t capacity() const;
+
+  V* get(const K&);
+
+  bool contains(const K&) const;
+
+  size_t frequency(const K&) const;
+
+  V& put(const K&, V);
+
+  bool erase(const K&);
+
+  void clear();
+
+  size_t hits() const;
+
+  size_t misses() const;
+
+  size_t evictions() const;
+
+  void reset_stats();
+
+private:
+  Handle* find(const K&, size_t);
+
+  const Handle* find(const K&, size_t) const;
+
+  void touch(Handle&);
+
+  void drop_if_empty(typename Buckets::iterator);
+};
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+LfuCache<K, V, Alloc, Hash, KeyEqual>::LfuCache(size_t capacity, const Alloc& alloc) : alloc_(alloc), buckets_(BucketAlloc(alloc)), index_(capacity, alloc), capacity_(capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("LfuCache capacity must be positive");
+  }
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::capacity() const {
+  return capacity_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+V* LfuCache<K, V, Alloc, Hash, KeyEqual>::get(const K& key) {
+  Handle* handle = find(key, hash_(key));
+  if (handle == nullptr) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  touch(*handle);
+  return &handle->entry->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+bool LfuCache<K, V, Alloc, Hash, KeyEqual>::contains(const K& key) const {
+  return find(key, hash_(key)) != nullptr;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::frequency(const K& key) const {
+  const Handle* handle = find(key, hash_(key));
+  return handle == nullptr ? 0 : handle->bucket->frequency;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+V& LfuCache<K, V, Alloc, Hash, KeyEqual>::put(const K& key, V value) {
+  size_t hash = hash_(key);
+  if (Handle* handle = find(key, hash)) {
+    handle->entry->second = std::move(value);
+    touch(*handle);
+    return handle->entry->second;
+  }
+  typename Buckets::iterator coldest = buckets_.begin();
+  typename Buckets::iterator first = buckets_.begin();
+  if (first == buckets_.end() || first->frequency != 1) {
+    first = buckets_.emplace(first, 1, alloc_);
+  }
+  if (size_ == capacity_) {
+    typename Entries::iterator victim = std::prev(coldest->entries.end());
+    index_.erase(hash_(victim->first), [&](const Handle& handle) { return handle.entry == victim; });
+    evictions_++;
+    try {
+      victim->first = key;
+      victim->second = std::move(value);
+    } catch (...) {
+      coldest->entries.erase(victim);
+      size_--;
+      if (coldest != first) {
+        drop_if_empty(coldest);
+      }
+      drop_if_empty(first);
+      throw;
+    }
+    first->entries.splice(first->entries.begin(), coldest->entries, victim);
+    drop_if_empty(coldest);
+  } else {
+    try {
+      first->entries.emplace_front(key, std::move(value));
+    } catch (...) {
+      drop_if_empty(first);
+      throw;
+    }
+    size_++;
+  }
+  index_.insert(hash, Handle{first->entries.begin(), first});
+  return first->entries.begin()->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+bool LfuCache<K, V, Alloc, Hash, KeyEqual>::erase(const K& key) {
+  Handle* found = find(key, hash_(key));
+  if (found == nullptr) {
+    return false;
+  }
+  Handle handle = *found;
+  index_.erase(hash_(key), [&](const Handle& other) { return other.entry == handle.entry; });
+  handle.bucket->entries.erase(handle.entry);
+  size_--;
+  drop_if_empty(handle.bucket);
+  return true;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LfuCache<K, V, Alloc, Hash, KeyEqual>::clear() {
+  index_.clear();
+  buckets_.clear();
+  size_ = 0;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::hits() const {
+  return hits_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::misses() const {
+  return misses_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+size_t LfuCache<K, V, Alloc, Hash, KeyEqual>::evictions() const {
+  return evictions_;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LfuCache<K, V, Alloc, Hash, KeyEqual>::reset_stats() {
+  hits_ = 0;
+  misses_ = 0;
+  evictions_ = 0;
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+typename LfuCache<K, V, Alloc, Hash, KeyEqual>::Handle* LfuCache<K, V, Alloc, Hash, KeyEqual>::find(const K& key, size_t hash) {
+  return index_.find(hash, [&](const Handle& handle) { return equal_(handle.entry->first, key); });
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+const typename LfuCache<K, V, Alloc, Hash, KeyEqual>::Handle* LfuCache<K, V, Alloc, Hash, KeyEqual>::find(const K& key, size_t hash) const {
+  return index_.find(hash, [&](const Handle& handle) { return equal_(handle.entry->first, key); });
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LfuCache<K, V, Alloc, Hash, KeyEqual>::touch(Handle& handle) {
+  typename Buckets::iterator bucket = handle.bucket;
+  typename Buckets::iterator next = std::next(bucket);
+  if (next == buckets_.end() || next->frequency != bucket->frequency + 1) {
+    next = buckets_.emplace(next, bucket->frequency + 1, alloc_);
+  }
+  next->entries.splice(next->entries.begin(), bucket->entries, handle.entry);
+  handle.bucket = next;
+  drop_if_empty(bucket);
+}
+
+template <typename K, typename V, typename Alloc, typename Hash, typename KeyEqual>
+void LfuCache<K, V, Alloc, Hash, KeyEqual>::drop_if_empty(typename Buckets::iterator bucket) {
+  if (bucket->entries.size() == 0) {
+    buckets_.erase(bucket);
+  }
+}
+
+class EpochDomain {
+  struct alignas(64) Record {
+    std::atomic<size_t> epoch{0};
+    std::atomic<bool> in_use{true};
+    size_t nesting = 0;
+    Record* next = nullptr;
+  };
 
-  template <typename U>
-  struct rebind {
-    using other = StackAllocator<U, N>;
+  struct Holder {
+    Record* record;
+
+    Holder() : record(acquire()) {}
+
+    ~Holder() {
+      record->epoch.store(0, std::memory_order_release);
+      record->nesting = 0;
+      record->in_use.store(false, std::memory_order_release);
+    }
   };
 
-  template <typename S, size_t M>
-  bool operator==(StackAllocator<S, M>& other) {
-    return storage_ == other.storage_;
+  inline static std::atomic<size_t> global_epoch_{1};
+  inline static std::atomic<Record*> records_;
+
+  static Record* acquire() {
+    for (Record* record = records_.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+      bool expected = false;
+      if (record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        return record;
+      }
+    }
+    Record* record = new Record();
+    record->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {}
+    return record;
   }
 
-  template <typename S, size_t M>
-  bool operator!=(StackAllocator<S, M>& other) {
-    return !(*this == other);
+  static Record& local() {
+    static thread_local Holder holder;
+    return *holder.record;
   }
 
-  StackAllocator select_on_container_copy_construction() { return *this; }
+public:
+  static void pin() {
+    Record& record = local();
+    if (record.nesting++ == 0) {
+      record.epoch.store(global_epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+  }
 
-  using propagate_on_container_copy_assignment = std::true_type;
+  static void unpin() {
+    Record& record = local();
+    if (--record.nesting == 0) {
+      record.epoch.store(0, std::memory_order_release);
+    }
+  }
 
-  template <typename U, size_t M>
-  friend class StackAllocator;
-};
+  static size_t epoch() { return global_epoch_.load(std::memory_order_seq_cst); }
 
-template <typename T, typename Alloc = std::allocator<T>>
-class List {
+  static bool try_advance() {
+    size_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+    for (Record* record = records_.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+      size_t local_epoch = record->epoch.load(std::memory_order_seq_cst);
+      if (local_epoch != 0 && local_epoch != epoch) {
+        return false;
+      }
+    }
+    return global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
 
-  struct BaseNode {
-    BaseNode* prev = nullptr;
-    BaseNode* next = nullptr;
-  };
+  class Guard {
+  public:
+    Guard() { pin(); }
 
-  struct Node: BaseNode {
-    T value = T();
+    Guard(const Guard&) = delete;
 
-    Node() {}
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard() { unpin(); }
+  };
+};
 
-    Node(const T& value) : value(value) {}
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+class ConcurrentList {
+  struct Node {
+    T value;
+    std::atomic<uintptr_t> next{0};
+    Node* next_retired = nullptr;
+    size_t retire_epoch = 0;
 
-    Node(T&& value) : value(std::move(value)) {}
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {}
   };
 
   using NodeAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<Node>;
   using NodeTraits = std::allocator_traits<NodeAlloc>;
 
+  static constexpr uintptr_t mark_bit = 1;
+  static constexpr size_t reclaim_period = 64;
+
   [[no_unique_address]] NodeAlloc alloc_;
-  BaseNode fake_node_ = {&fake_node_, &fake_node_};
-  size_t sz_ = 0;
+  [[no_unique_address]] Compare comp_;
+  std::atomic<uintptr_t> head_{0};
+  std::atomic<size_t> sz_{0};
+  std::atomic<Node*> retired_{nullptr};
+  std::atomic<size_t> retired_count_{0};
 
 public:
-  List();
+  ConcurrentList();
 
-  List(size_t);
+  explicit ConcurrentList(const Alloc&);
 
-  List(size_t, const T&);
+  ConcurrentList(const ConcurrentList&) = delete;
 
-  List(const Alloc&);
+  ConcurrentList& operator=(const ConcurrentList&) = delete;
 
-  List(size_t, const Alloc&);
+  ~ConcurrentList();
 
-  List(size_t, const T&, const Alloc&);
+  Alloc get_allocator() const;
 
-  List(const List&);
+  size_t size() const;
 
-  List(List&&);
+  bool empty() const;
 
-  List& operator=(const List&);
+  bool insert(const T&);
 
-  List& operator=(List&&);
+  bool insert(T&&);
 
-  ~List();
+  template <typename... Args>
+  bool emplace(Args&&...);
 
-  Alloc get_allocator() const;
+  bool erase(const T&);
 
-  size_t size() const;
+  bool contains(const T&) const;
 
-  void push_back(const T&);
+  class const_iterator {
+  public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+    using iterator_category = std::forward_iterator_tag;
 
-  void push_back(T&&);
+  private:
+    Node* ptr_ = nullptr;
+    bool pinned_ = false;
 
-  void push_front(const T&);
+    explicit const_iterator(Node* ptr);
 
-  void push_front(T&&);
+    void skip_removed();
 
-  void pop_back();
+  public:
+    const_iterator() = default;
 
-  void pop_front();
+    const_iterator(const const_iterator&);
+
+    const_iterator& operator=(const const_iterator&);
+
+    ~const_iterator();
+
+    const_iterator& operator++();
+
+    const_iterator operator++(int);
+
+    bool operator==(const const_iterator&) const;
+
+    bool operator!=(const const_iterator&) const;
+
+    reference operator*() const;
+
+    pointer operator->() const;
+
+    friend class ConcurrentList;
+  };
+
+  using iterator = const_iterator;
+
+  const_iterator begin() const;
+
+  const_iterator cbegin() const;
+
+  const_iterator end() const;
+
+  const_iterator cend() const;
+
+  const_iterator find(const T&) const;
+
+private:
+  static Node* to_node(uintptr_t);
+
+  static bool is_marked(uintptr_t);
+
+  bool insert_node(Node*);
+
+  std::pair<std::atomic<uintptr_t>*, Node*> search(const T&);
+
+  void destroy_node(Node*);
+
+  void retire(Node*);
+
+  void reclaim();
+};
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::ConcurrentList() : ConcurrentList(Alloc()) {}
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::ConcurrentList(const Alloc& alloc) : alloc_(alloc) {}
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::~ConcurrentList() {
+  Node* node = to_node(head_.load(std::memory_order_acquire));
+  while (node != nullptr) {
+    Node* next = to_node(node->next.load(std::memory_order_relaxed));
+    destroy_node(node);
+    node = next;
+  }
+  node = retired_.load(std::memory_order_acquire);
+  while (node != nullptr) {
+    Node* next = node->next_retired;
+    destroy_node(node);
+    node = next;
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+Alloc ConcurrentList<T, Compare, Alloc>::get_allocator() const {
+  return Alloc(alloc_);
+}
+
+template <typename T, typename Compare, typename Alloc>
+size_t ConcurrentList<T, Compare, Alloc>::size() const {
+  return sz_.load(std::memory_order_relaxed);
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::empty() const {
+  return size() == 0;
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::insert(const T& value) {
+  return emplace(value);
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::insert(T&& value) {
+  return emplace(std::move(value));
+}
+
+template <typename T, typename Compare, typename Alloc>
+template <typename... Args>
+bool ConcurrentList<T, Compare, Alloc>::emplace(Args&&... args) {
+  Node* node = NodeTraits::allocate(alloc_, 1);
+  try {
+    NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+  } catch (...) {
+    NodeTraits::deallocate(alloc_, node, 1);
+    throw;
+  }
+  return insert_node(node);
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::insert_node(Node* node) {
+  EpochDomain::Guard guard;
+  while (true) {
+    auto [prev, curr] = search(node->value);
+    if (curr != nullptr && !comp_(node->value, curr->value)) {
+      destroy_node(node);
+      return false;
+    }
+    uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+    node->next.store(expected, std::memory_order_relaxed);
+    if (prev->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node), std::memory_order_release, std::memory_order_relaxed)) {
+      sz_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::erase(const T& value) {
+  EpochDomain::Guard guard;
+  while (true) {
+    auto [prev, curr] = search(value);
+    if (curr == nullptr || comp_(value, curr->value)) {
+      return false;
+    }
+    uintptr_t next = curr->next.load(std::memory_order_acquire);
+    if (is_marked(next)) {
+      continue;
+    }
+    if (!curr->next.compare_exchange_strong(next, next | mark_bit, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      continue;
+    }
+    sz_.fetch_sub(1, std::memory_order_relaxed);
+    uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+    if (prev->compare_exchange_strong(expected, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      retire(curr);
+    } else {
+      search(value);
+    }
+    return true;
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::contains(const T& value) const {
+  EpochDomain::Guard guard;
+  Node* curr = to_node(head_.load(std::memory_order_acquire));
+  while (curr != nullptr && comp_(curr->value, value)) {
+    curr = to_node(curr->next.load(std::memory_order_acquire));
+  }
+  return curr != nullptr && !comp_(value, curr->value) && !is_marked(curr->next.load(std::memory_order_acquire));
+}
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::const_iterator::const_iterator(Node* ptr) : ptr_(ptr), pinned_(true) {}
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::const_iterator::const_iterator(const const_iterator& other) : ptr_(other.ptr_), pinned_(other.pinned_) {
+  if (pinned_) {
+    EpochDomain::pin();
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator& ConcurrentList<T, Compare, Alloc>::const_iterator::operator=(const const_iterator& other) {
+  if (other.pinned_) {
+    EpochDomain::pin();
+  }
+  if (pinned_) {
+    EpochDomain::unpin();
+  }
+  ptr_ = other.ptr_;
+  pinned_ = other.pinned_;
+  return *this;
+}
+
+template <typename T, typename Compare, typename Alloc>
+ConcurrentList<T, Compare, Alloc>::const_iterator::~const_iterator() {
+  if (pinned_) {
+    EpochDomain::unpin();
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+void ConcurrentList<T, Compare, Alloc>::const_iterator::skip_removed() {
+  while (ptr_ != nullptr) {
+    uintptr_t next = ptr_->next.load(std::memory_order_acquire);
+    if (!is_marked(next)) {
+      return;
+    }
+    ptr_ = to_node(next);
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator& ConcurrentList<T, Compare, Alloc>::const_iterator::operator++() {
+  ptr_ = to_node(ptr_->next.load(std::memory_order_acquire));
+  skip_removed();
+  return *this;
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::const_iterator::operator++(int) {
+  const_iterator temp = *this;
+  ++*this;
+  return temp;
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::const_iterator::operator==(const const_iterator& other) const {
+  return ptr_ == other.ptr_;
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::const_iterator::operator!=(const const_iterator& other) const {
+  return !(*this == other);
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator::reference ConcurrentList<T, Compare, Alloc>::const_iterator::operator*() const {
+  return ptr_->value;
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator::pointer ConcurrentList<T, Compare, Alloc>::const_iterator::operator->() const {
+  return &ptr_->value;
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::begin() const {
+  EpochDomain::pin();
+  const_iterator iter(to_node(head_.load(std::memory_order_acquire)));
+  iter.skip_removed();
+  return iter;
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::cbegin() const {
+  return begin();
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::end() const {
+  return const_iterator();
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::cend() const {
+  return const_iterator();
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::const_iterator ConcurrentList<T, Compare, Alloc>::find(const T& value) const {
+  EpochDomain::pin();
+  const_iterator iter(to_node(head_.load(std::memory_order_acquire)));
+  while (iter.ptr_ != nullptr && comp_(iter.ptr_->value, value)) {
+    iter.ptr_ = to_node(iter.ptr_->next.load(std::memory_order_acquire));
+  }
+  if (iter.ptr_ == nullptr || comp_(value, iter.ptr_->value) || is_marked(iter.ptr_->next.load(std::memory_order_acquire))) {
+    return end();
+  }
+  return iter;
+}
+
+template <typename T, typename Compare, typename Alloc>
+typename ConcurrentList<T, Compare, Alloc>::Node* ConcurrentList<T, Compare, Alloc>::to_node(uintptr_t link) {
+  return reinterpret_cast<Node*>(link & ~mark_bit);
+}
+
+template <typename T, typename Compare, typename Alloc>
+bool ConcurrentList<T, Compare, Alloc>::is_marked(uintptr_t link) {
+  return (link & mark_bit) != 0;
+}
+
+template <typename T, typename Compare, typename Alloc>
+std::pair<std::atomic<uintptr_t>*, typename ConcurrentList<T, Compare, Alloc>::Node*> ConcurrentList<T, Compare, Alloc>::search(const T& value) {
+  while (true) {
+    std::atomic<uintptr_t>* prev = &head_;
+    Node* curr = to_node(prev->load(std::memory_order_acquire));
+    bool restart = false;
+    while (curr != nullptr) {
+      uintptr_t next = curr->next.load(std::memory_order_acquire);
+      if (is_marked(next)) {
+        uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+        if (!prev->compare_exchange_strong(expected, next & ~mark_bit, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+          restart = true;
+          break;
+        }
+        retire(curr);
+        curr = to_node(next);
+        continue;
+      }
+      if (!comp_(curr->value, value)) {
+        break;
+      }
+      prev = &curr->next;
+      curr = to_node(next);
+    }
+    if (!restart) {
+      return {prev, curr};
+    }
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+void ConcurrentList<T, Compare, Alloc>::destroy_node(Node* node) {
+  NodeTraits::destroy(alloc_, node);
+  NodeTraits::deallocate(alloc_, node, 1);
+}
+
+template <typename T, typename Compare, typename Alloc>
+void ConcurrentList<T, Compare, Alloc>::retire(Node* node) {
+  node->retire_epoch = EpochDomain::epoch();
+  node->next_retired = retired_.load(std::memory_order_relaxed);
+  while (!retired_.compare_exchange_weak(node->next_retired, node, std::memory_order_release, std::memory_order_relaxed)) {}
+  if (retired_count_.fetch_add(1, std::memory_order_relaxed) % reclaim_period == reclaim_period - 1) {
+    reclaim();
+  }
+}
+
+template <typename T, typename Compare, typename Alloc>
+void ConcurrentList<T, Compare, Alloc>::reclaim() {
+  EpochDomain::try_advance();
+  size_t epoch = EpochDomain::epoch();
+  Node* node = retired_.exchange(nullptr, std::memory_order_acquire);
+  Node* keep_first = nullptr;
+  Node* keep_last = nullptr;
+  while (node != nullptr) {
+    Node* next = node->next_retired;
+    if (node->retire_epoch + 2 <= epoch) {
+      destroy_node(node);
+    } else {
+      node->next_retired = keep_first;
+      keep_first = node;
+      if (keep_last == nullptr) {
+        keep_last = node;
+      }
+    }
+    node = next;
+  }
+  if (keep_first != nullptr) {
+    keep_last->next_retired = retired_.load(std::memory_order_relaxed);
+    while (!retired_.compare_exchange_weak(keep_last->next_retired, keep_first, std::memory_order_release, std::memory_order_relaxed)) {}
+  }
+}
+
+template <typename K, typename V, typename Alloc = std::allocator<std::pair<const K, V>>, typename Compare = std::less<K>>
+class SkipList {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+
+private:
+  static constexpr size_t max_height = 32;
+
+  struct BaseNode {
+    BaseNode* prev = nullptr;
+    BaseNode** next = nullptr;
+    size_t height = 0;
+  };
+
+  struct Node: BaseNode {
+    value_type value;
+
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  struct NodeBlock {
+    alignas(Node) unsigned char data[alignof(Node)];
+  };
+
+  using NodeAlloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<NodeBlock>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  static constexpr size_t links_offset = (sizeof(Node) + alignof(BaseNode*) - 1) / alignof(BaseNode*) * alignof(BaseNode*);
+
+  [[no_unique_address]] NodeAlloc alloc_;
+  [[no_unique_address]] Compare comp_;
+  BaseNode* head_links_[max_height];
+  BaseNode head_;
+  size_t height_ = 1;
+  size_t sz_ = 0;
+  uint64_t seed_ = 0x9e3779b97f4a7c15ULL;
+
+public:
+  SkipList();
+
+  explicit SkipList(const Alloc&);
+
+  SkipList(const SkipList&);
+
+  SkipList(SkipList&&);
+
+  SkipList& operator=(const SkipList&);
+
+  SkipList& operator=(SkipList&&);
+
+  ~SkipList();
+
+  Alloc get_allocator() const;
+
+  size_t size() const;
+
+  bool empty() const;
 
   template <bool is_const>
   class common_iterator {
   public:
-    using value_type = T;
-    using difference_type = int;
-    using reference = std::conditional_t<is_const, const T&, T&>;
-    using pointer = std::conditional_t<is_const, const T*, T*>;
+    using value_type = SkipList::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+    using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
     using iterator_category = std::bidirectional_iterator_tag;
 
   private:
     using basenode_pointer = std::conditional_t<is_const, const BaseNode*, BaseNode*>;
     using node_pointer = std::conditional_t<is_const, const Node*, Node*>;
 
-    basenode_pointer ptr_;
+    basenode_pointer ptr_ = nullptr;
 
   public:
     common_iterator() = default;
@@ -169,7 +3547,7 @@ public:
 
     pointer operator->() const;
 
-    friend class List;
+    friend class SkipList;
   };
 
   using iterator = common_iterator<false>;
@@ -181,318 +3559,545 @@ public:
 
   const_iterator cbegin() const;
 
-  iterator end();
+  iterator end();
+
+  const_iterator end() const;
+
+  const_iterator cend() const;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  reverse_iterator rbegin();
+
+  const_reverse_iterator rbegin() const;
+
+  reverse_iterator rend();
+
+  const_reverse_iterator rend() const;
+
+  iterator find(const K&);
+
+  const_iterator find(const K&) const;
 
-  const_iterator end() const;
+  bool contains(const K&) const;
 
-  const_iterator cend() const;
+  iterator lower_bound(const K&);
 
-  using reverse_iterator = std::reverse_iterator<iterator>;
-  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  const_iterator lower_bound(const K&) const;
 
-  reverse_iterator rbegin();
+  iterator upper_bound(const K&);
 
-  const_reverse_iterator rbegin() const;
+  const_iterator upper_bound(const K&) const;
 
-  const_reverse_iterator crbegin() const;
+  V& at(const K&);
 
-  reverse_iterator rend();
+  const V& at(const K&) const;
 
-  const_reverse_iterator rend() const;
+  V& operator[](const K&);
 
-  const_reverse_iterator crend() const;
+  std::pair<iterator, bool> insert(const value_type&);
 
-  iterator insert(const_iterator, const T&);
+  std::pair<iterator, bool> insert(value_type&&);
 
-  iterator insert(const_iterator, T&&);
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&...);
 
   iterator erase(const_iterator);
 
+  size_t erase(const K&);
+
+  void clear();
+
+  void swap(SkipList&);
+
 private:
-  template <typename... Args>
-  iterator emplace(const_iterator, Args&&...);
+  static const K& key_of(const BaseNode*);
 
-  void swap(List&);
+  static BaseNode** links_of(Node*);
 
-  void swap(List&&);
-};
+  bool is_end(const BaseNode*) const;
 
-template <typename T, typename Alloc>
-void List<T, Alloc>::swap(List& other) {
-  std::swap(fake_node_.next->prev, other.fake_node_.next->prev);
-  std::swap(fake_node_.prev->next, other.fake_node_.prev->next);
-  std::swap(fake_node_, other.fake_node_);
-  std::swap(sz_, other.sz_);
-}
+  size_t random_height();
 
-template <typename T, typename Alloc>
-void List<T, Alloc>::swap(List&& other) {
-  std::swap(fake_node_.next->prev, other.fake_node_.next->prev);
-  std::swap(fake_node_.prev->next, other.fake_node_.prev->next);
-  std::swap(fake_node_, other.fake_node_);
-  std::swap(sz_, other.sz_);
-}
+  const BaseNode* lower_node(const K&) const;
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List() : List(Alloc()) {}
+  const BaseNode* upper_node(const K&) const;
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t sz) : List(sz, Alloc()) {}
+  template <typename... Args>
+  Node* create_node(size_t, Args&&...);
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t sz, const T& value) : List(sz, value, Alloc()) {}
+  void destroy_node(Node*);
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(const Alloc& alloc) : alloc_(alloc) {}
+  std::pair<iterator, bool> link_node(Node*);
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t sz, const Alloc& alloc) : alloc_(alloc) {
-  try {
-    for (size_t i = 0 ; i < sz; i++) {
-      emplace(end());
-    }
-  } catch (...) {
-    while (sz_ != 0) {
-      pop_back();
-    }
-    throw;
-  }
-}
+  void swap_nodes(SkipList&);
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t sz, const T& value, const Alloc& alloc ) : alloc_(alloc) {
-  try {
-    for (size_t i = 0; i < sz; i++) {
-      insert(end(), value);
-    }
-  } catch (...) {
-    while (sz_ != 0) {
-      pop_back();
-    }
-    throw;
-  }
+  void reset_head();
+};
+
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>::SkipList() : SkipList(Alloc()) {}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>::SkipList(const Alloc& alloc) : alloc_(alloc) {
+  head_.next = head_links_;
+  head_.height = max_height;
+  reset_head();
 }
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(const List& other) : alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())) {
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>::SkipList(const SkipList& other) : SkipList(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())) {
+  comp_ = other.comp_;
   try {
-    for (const T& value : other) {
-      insert(end(), value);
+    for (const value_type& value : other) {
+      emplace(value);
     }
   } catch (...) {
-    while (sz_ != 0) {
-      pop_back();
-    }
+    clear();
     throw;
   }
 }
 
-template <typename T, typename Alloc>
-List<T, Alloc>::List(List&& other) : alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_allocator())){
-  swap(std::move(other));
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>::SkipList(SkipList&& other) : SkipList(other.get_allocator()) {
+  comp_ = other.comp_;
+  swap_nodes(other);
 }
 
-template <typename T, typename Alloc>
-List<T, Alloc>& List<T, Alloc>::operator=(const List& other) {
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>& SkipList<K, V, Alloc, Compare>::operator=(const SkipList& other) {
+  if (this == &other) {
+    return *this;
+  }
   if (std::allocator_traits<Alloc>::propagate_on_container_copy_assignment::value) {
+    clear();
     alloc_ = other.alloc_;
   }
-
-  List temp = other;
-  swap(temp);
+  SkipList temp(get_allocator());
+  temp.comp_ = other.comp_;
+  for (const value_type& value : other) {
+    temp.emplace(value);
+  }
+  clear();
+  comp_ = other.comp_;
+  swap_nodes(temp);
   return *this;
 }
 
-template <typename T, typename Alloc>
-List<T, Alloc>& List<T, Alloc>::operator=(List&& other) {
-  while (sz_ != 0) {
-    pop_back();
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>& SkipList<K, V, Alloc, Compare>::operator=(SkipList&& other) {
+  if (this == &other) {
+    return *this;
   }
-  if (std::allocator_traits<Alloc>::propagate_on_container_copy_assignment::value) {
+  clear();
+  comp_ = other.comp_;
+  if constexpr (std::allocator_traits<Alloc>::propagate_on_container_move_assignment::value) {
     alloc_ = other.alloc_;
+  } else if constexpr (!NodeTraits::is_always_equal::value) {
+    if (!(alloc_ == other.alloc_)) {
+      for (value_type& value : other) {
+        emplace(std::move(const_cast<K&>(value.first)), std::move(value.second));
+      }
+      other.clear();
+      return *this;
+    }
   }
-  swap(std::move(other));
+  swap_nodes(other);
+  return *this;
 }
 
-template <typename T, typename Alloc>
-List<T, Alloc>::~List() {
-  while (sz_ != 0) {
-    pop_back();
-  }
+template <typename K, typename V, typename Alloc, typename Compare>
+SkipList<K, V, Alloc, Compare>::~SkipList() {
+  clear();
 }
 
-template <typename T, typename Alloc>
-Alloc List<T, Alloc>::get_allocator() const { return typename NodeTraits:: template rebind_alloc<T>(alloc_); }
-
-template <typename T, typename Alloc>
-size_t List<T, Alloc>::size() const { return sz_; }
-
-template <typename T, typename Alloc>
-void List<T, Alloc>::push_back(const T& value) { insert(end(), value); }
-
-template <typename T, typename Alloc>
-void List<T, Alloc>::push_back(T&& value) { insert(end(), std::move(value)); }
-
-template <typename T, typename Alloc>
-void List<T, Alloc>::push_front(const T& value) { insert(begin(), value); }
-
-template <typename T, typename Alloc>
-void List<T, Alloc>::push_front(T&& value) { insert(begin(), std::move(value)); }
+template <typename K, typename V, typename Alloc, typename Compare>
+Alloc SkipList<K, V, Alloc, Compare>::get_allocator() const {
+  return Alloc(alloc_);
+}
 
-template <typename T, typename Alloc>
-void List<T, Alloc>::pop_back() { erase(--end()); }
+template <typename K, typename V, typename Alloc, typename Compare>
+size_t SkipList<K, V, Alloc, Compare>::size() const {
+  return sz_;
+}
 
-template <typename T, typename Alloc>
-void List<T, Alloc>::pop_front() { erase(begin()); }
+template <typename K, typename V, typename Alloc, typename Compare>
+bool SkipList<K, V, Alloc, Compare>::empty() const {
+  return sz_ == 0;
+}
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const>& List<T, Alloc>::common_iterator<is_const>::operator++() {
-  ptr_ = ptr_->next;
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const>& SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator++() {
+  ptr_ = ptr_->next[0];
   return *this;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const> List<T, Alloc>::common_iterator<is_const>::operator++(int) {
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const> SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator++(int) {
   common_iterator<is_const> temp = *this;
-  ptr_ = ptr_->next;
+  ptr_ = ptr_->next[0];
   return temp;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const>& List<T, Alloc>::common_iterator<is_const>::operator--() {
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const>& SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator--() {
   ptr_ = ptr_->prev;
   return *this;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const> List<T, Alloc>::common_iterator<is_const>::operator--(int) {
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const> SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator--(int) {
   common_iterator<is_const> temp = *this;
   ptr_ = ptr_->prev;
   return temp;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-bool List<T, Alloc>::common_iterator<is_const>::operator==(const common_iterator& other) const {
+bool SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator==(const common_iterator& other) const {
   return ptr_ == other.ptr_;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-bool List<T, Alloc>::common_iterator<is_const>::operator!=(const common_iterator& other) const {
+bool SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator!=(const common_iterator& other) const {
   return !(*this == other);
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const>::reference List<T, Alloc>::common_iterator<is_const>::operator*() const {
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const>::reference SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator*() const {
   return static_cast<node_pointer>(ptr_)->value;
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
 template <bool is_const>
-typename List<T, Alloc>:: template common_iterator<is_const>::pointer List<T, Alloc>::common_iterator<is_const>::operator->() const {
+typename SkipList<K, V, Alloc, Compare>:: template common_iterator<is_const>::pointer SkipList<K, V, Alloc, Compare>::common_iterator<is_const>::operator->() const {
   return &(static_cast<node_pointer>(ptr_)->value);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::iterator List<T, Alloc>::begin() {
-  return iterator(static_cast<typename iterator::basenode_pointer>(fake_node_.next));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::begin() {
+  return iterator(head_.next[0]);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_iterator List<T, Alloc>::begin() const {
-  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(fake_node_.next));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::begin() const {
+  return const_iterator(head_.next[0]);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_iterator List<T, Alloc>::cbegin() const {
-  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(fake_node_.next));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::cbegin() const {
+  return const_iterator(head_.next[0]);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::iterator List<T, Alloc>::end() {
-  return iterator(static_cast<typename iterator::basenode_pointer>(&fake_node_));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::end() {
+  return iterator(&head_);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_iterator List<T, Alloc>::end() const {
-  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(&fake_node_));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::end() const {
+  return const_iterator(&head_);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_iterator List<T, Alloc>::cend() const {
-  return const_iterator(static_cast<typename const_iterator::basenode_pointer>(&fake_node_));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::cend() const {
+  return const_iterator(&head_);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rbegin() {
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::reverse_iterator SkipList<K, V, Alloc, Compare>::rbegin() {
   return std::make_reverse_iterator(end());
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rbegin() const {
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_reverse_iterator SkipList<K, V, Alloc, Compare>::rbegin() const {
   return std::make_reverse_iterator(end());
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crbegin() const {
-  return std::make_reverse_iterator(cend());
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::reverse_iterator SkipList<K, V, Alloc, Compare>::rend() {
+  return std::make_reverse_iterator(begin());
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rend() {
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_reverse_iterator SkipList<K, V, Alloc, Compare>::rend() const {
   return std::make_reverse_iterator(begin());
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rend() const {
-  return std::make_reverse_iterator(begin());
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::find(const K& key) {
+  BaseNode* node = const_cast<BaseNode*>(lower_node(key));
+  if (node == &head_ || comp_(key, key_of(node))) {
+    return end();
+  }
+  return iterator(node);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crend() const {
-  return std::make_reverse_iterator(cbegin());
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::find(const K& key) const {
+  const BaseNode* node = lower_node(key);
+  if (node == &head_ || comp_(key, key_of(node))) {
+    return end();
+  }
+  return const_iterator(node);
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, const T& value) {
-  return emplace(iter, value);
+template <typename K, typename V, typename Alloc, typename Compare>
+bool SkipList<K, V, Alloc, Compare>::contains(const K& key) const {
+  return find(key) != end();
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::iterator List<T, Alloc>::insert(const_iterator iter, T&& value) {
-  return emplace(iter, std::move(value));
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::lower_bound(const K& key) {
+  return iterator(const_cast<BaseNode*>(lower_node(key)));
 }
 
-template <typename T, typename Alloc>
-typename List<T, Alloc>::iterator List<T, Alloc>::erase(const_iterator iter) {
-  BaseNode* next = iter.ptr_->next;
-  BaseNode* prev = iter.ptr_->prev;
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::lower_bound(const K& key) const {
+  return const_iterator(lower_node(key));
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::upper_bound(const K& key) {
+  return iterator(const_cast<BaseNode*>(upper_node(key)));
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::const_iterator SkipList<K, V, Alloc, Compare>::upper_bound(const K& key) const {
+  return const_iterator(upper_node(key));
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+V& SkipList<K, V, Alloc, Compare>::at(const K& key) {
+  iterator iter = find(key);
+  if (iter == end()) {
+    throw std::out_of_range("SkipList::at");
+  }
+  return iter->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+const V& SkipList<K, V, Alloc, Compare>::at(const K& key) const {
+  const_iterator iter = find(key);
+  if (iter == end()) {
+    throw std::out_of_range("SkipList::at");
+  }
+  return iter->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+V& SkipList<K, V, Alloc, Compare>::operator[](const K& key) {
+  iterator iter = find(key);
+  if (iter != end()) {
+    return iter->second;
+  }
+  return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first->second;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+std::pair<typename SkipList<K, V, Alloc, Compare>::iterator, bool> SkipList<K, V, Alloc, Compare>::insert(const value_type& value) {
+  return emplace(value);
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+std::pair<typename SkipList<K, V, Alloc, Compare>::iterator, bool> SkipList<K, V, Alloc, Compare>::insert(value_type&& value) {
+  return emplace(std::move(value));
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+template <typename... Args>
+std::pair<typename SkipList<K, V, Alloc, Compare>::iterator, bool> SkipList<K, V, Alloc, Compare>::emplace(Args&&... args) {
+  return link_node(create_node(random_height(), std::forward<Args>(args)...));
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::iterator SkipList<K, V, Alloc, Compare>::erase(const_iterator iter) {
   Node* node = static_cast<Node*>(const_cast<BaseNode*>(iter.ptr_));
-  NodeTraits::destroy(alloc_, node);
-  NodeTraits::deallocate(alloc_, node, 1);
-  prev->next = next;
-  next->prev = prev;
+  const K& key = node->value.first;
+  BaseNode* current = &head_;
+  for (size_t level = height_; level-- > 0;) {
+    while (!is_end(current->next[level]) && comp_(key_of(current->next[level]), key)) {
+      current = current->next[level];
+    }
+    if (current->next[level] == node) {
+      current->next[level] = node->next[level];
+    }
+  }
+  BaseNode* next = node->next[0];
+  next->prev = node->prev;
+  while (height_ > 1 && head_.next[height_ - 1] == nullptr) {
+    height_--;
+  }
   sz_--;
+  destroy_node(node);
   return iterator(next);
 }
 
-template <typename T, typename Alloc>
+template <typename K, typename V, typename Alloc, typename Compare>
+size_t SkipList<K, V, Alloc, Compare>::erase(const K& key) {
+  iterator iter = find(key);
+  if (iter == end()) {
+    return 0;
+  }
+  erase(iter);
+  return 1;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+void SkipList<K, V, Alloc, Compare>::clear() {
+  BaseNode* node = head_.next[0];
+  while (node != &head_) {
+    BaseNode* next = node->next[0];
+    destroy_node(static_cast<Node*>(node));
+    node = next;
+  }
+  reset_head();
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+void SkipList<K, V, Alloc, Compare>::swap(SkipList& other) {
+  if constexpr (std::allocator_traits<Alloc>::propagate_on_container_swap::value) {
+    std::swap(alloc_, other.alloc_);
+  }
+  std::swap(comp_, other.comp_);
+  swap_nodes(other);
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+const K& SkipList<K, V, Alloc, Compare>::key_of(const BaseNode* node) {
+  return static_cast<const Node*>(node)->value.first;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+typename SkipList<K, V, Alloc, Compare>::BaseNode** SkipList<K, V, Alloc, Compare>::links_of(Node* node) {
+  return reinterpret_cast<BaseNode**>(reinterpret_cast<unsigned char*>(node) + links_offset);
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+bool SkipList<K, V, Alloc, Compare>::is_end(const BaseNode* node) const {
+  return node == nullptr || node == &head_;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+size_t SkipList<K, V, Alloc, Compare>::random_height() {
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 7;
+  seed_ ^= seed_ << 17;
+  uint64_t bits = seed_;
+  size_t height = 1;
+  while (height < max_height && (bits & 3) == 0) {
+    height++;
+    bits >>= 2;
+  }
+  return height;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+const typename SkipList<K, V, Alloc, Compare>::BaseNode* SkipList<K, V, Alloc, Compare>::lower_node(const K& key) const {
+  const BaseNode* current = &head_;
+  for (size_t level = height_; level-- > 0;) {
+    while (!is_end(current->next[level]) && comp_(key_of(current->next[level]), key)) {
+      current = current->next[level];
+    }
+  }
+  return current->next[0];
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+const typename SkipList<K, V, Alloc, Compare>::BaseNode* SkipList<K, V, Alloc, Compare>::upper_node(const K& key) const {
+  const BaseNode* current = &head_;
+  for (size_t level = height_; level-- > 0;) {
+    while (!is_end(current->next[level]) && !comp_(key, key_of(current->next[level]))) {
+      current = current->next[level];
+    }
+  }
+  return current->next[0];
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
 template <typename... Args>
-typename List<T, Alloc>::iterator List<T, Alloc>::emplace(const_iterator iter, Args&&... args) {
-  BaseNode* node = const_cast<BaseNode*>(iter.ptr_);
-  BaseNode* prev = node->prev;
-  Node* new_node = NodeTraits::allocate(alloc_, 1);
-  NodeTraits::construct(alloc_, new_node, std::forward<Args>(args)...);
-  prev->next = static_cast<BaseNode*>(new_node);
-  new_node->prev = prev;
-  new_node->next = node;
-  node->prev = static_cast<BaseNode*>(new_node);
+typename SkipList<K, V, Alloc, Compare>::Node* SkipList<K, V, Alloc, Compare>::create_node(size_t height, Args&&... args) {
+  size_t blocks = (links_offset + height * sizeof(BaseNode*) + sizeof(NodeBlock) - 1) / sizeof(NodeBlock);
+  Node* node = reinterpret_cast<Node*>(NodeTraits::allocate(alloc_, blocks));
+  try {
+    NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+  } catch (...) {
+    NodeTraits::deallocate(alloc_, reinterpret_cast<NodeBlock*>(node), blocks);
+    throw;
+  }
+  node->next = links_of(node);
+  node->height = height;
+  std::fill(node->next, node->next + height, nullptr);
+  return node;
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+void SkipList<K, V, Alloc, Compare>::destroy_node(Node* node) {
+  size_t blocks = (links_offset + node->height * sizeof(BaseNode*) + sizeof(NodeBlock) - 1) / sizeof(NodeBlock);
+  NodeTraits::destroy(alloc_, node);
+  NodeTraits::deallocate(alloc_, reinterpret_cast<NodeBlock*>(node), blocks);
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+std::pair<typename SkipList<K, V, Alloc, Compare>::iterator, bool> SkipList<K, V, Alloc, Compare>::link_node(Node* node) {
+  const K& key = node->value.first;
+  BaseNode* update[max_height];
+  BaseNode* current = &head_;
+  for (size_t level = height_; level-- > 0;) {
+    while (!is_end(current->next[level]) && comp_(key_of(current->next[level]), key)) {
+      current = current->next[level];
+    }
+    update[level] = current;
+  }
+  BaseNode* candidate = current->next[0];
+  if (candidate != &head_ && !comp_(key, key_of(candidate))) {
+    destroy_node(node);
+    return {iterator(candidate), false};
+  }
+  for (; height_ < node->height; height_++) {
+    update[height_] = &head_;
+  }
+  for (size_t level = 0; level < node->height; level++) {
+    node->next[level] = update[level]->next[level];
+    update[level]->next[level] = node;
+  }
+  node->prev = update[0];
+  node->next[0]->prev = node;
   sz_++;
-  return iterator(static_cast<BaseNode*>(new_node));
+  return {iterator(node), true};
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+void SkipList<K, V, Alloc, Compare>::swap_nodes(SkipList& other) {
+  std::swap(head_links_, other.head_links_);
+  std::swap(head_.prev, other.head_.prev);
+  std::swap(height_, other.height_);
+  std::swap(sz_, other.sz_);
+  for (SkipList* list : {this, &other}) {
+    SkipList* old = list == this ? &other : this;
+    BaseNode& head = list->head_;
+    if (head.next[0] == &old->head_) {
+      head.next[0] = &head;
+      head.prev = &head;
+    } else {
+      head.next[0]->prev = &head;
+      head.prev->next[0] = &head;
+    }
+  }
+}
+
+template <typename K, typename V, typename Alloc, typename Compare>
+void SkipList<K, V, Alloc, Compare>::reset_head() {
+  std::fill(head_links_, head_links_ + max_height, nullptr);
+  head_links_[0] = &head_;
+  head_.prev = &head_;
+  height_ = 1;
+  sz_ = 0;
 }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+template <typename Node>
+class TaggedStack {
+  static constexpr uint64_t tag_unit = uint64_t(1) << 48;
+  static constexpr uint64_t pointer_mask = tag_unit - 1;
+
+  static_assert(sizeof(uintptr_t) <= sizeof(uint64_t));
+
+  std::atomic<uint64_t> head_{0};
+
+  static Node* pointer(uint64_t word) { return reinterpret_cast<Node*>(static_cast<uintptr_t>(word & pointer_mask)); }
+
+  static uint64_t next_word(uint64_t word, Node* node) {
+    uint64_t address = reinterpret_cast<uintptr_t>(node);
+    if ((address & ~pointer_mask) != 0) {
+      std::abort();
+    }
+    return ((word & ~pointer_mask) + tag_unit) | address;
+  }
+
+public:
+  void push(Node* node) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      node->link.store(pointer(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, next_word(head, node), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  Node* pop() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (pointer(head) != nullptr) {
+      Node* next = pointer(head)->link.load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, next_word(head, next), std::memory_order_acquire, std::memory_order_acquire)) {
+        return pointer(head);
+      }
+    }
+    return nullptr;
+  }
+};
+
+class ThreadCache {
+  struct FreeBlock {
+    FreeBlock* next;
+    std::atomic<FreeBlock*> link;
+    size_t count;
+  };
+
+  struct Slab {
+    Slab* next;
+  };
+
+  struct Spare {
+    std::atomic<Spare*> link;
+    char* end;
+  };
+
+  struct Magazine {
+    FreeBlock* head;
+    size_t count;
+  };
+
+  static constexpr size_t granularity = alignof(std::max_align_t);
+  static constexpr size_t min_block_size = (sizeof(FreeBlock) + granularity - 1) / granularity * granularity;
+  static constexpr size_t max_block_size = 512;
+  static constexpr size_t size_classes = 31;
+  static constexpr size_t magazine_size = 64;
+  static constexpr size_t slab_size = 1 << 18;
+
+  static_assert((max_block_size - min_block_size) / granularity < size_classes);
+  static_assert(sizeof(Spare) <= min_block_size);
+
+  struct LocalCache {
+    Magazine loaded[size_classes];
+    char* ptr;
+    char* end;
+    bool exited;
+  };
+
+  struct Flusher {
+    ~Flusher() {
+      LocalCache& cache = local();
+      cache.exited = true;
+      retire(cache);
+    }
+  };
+
+  inline static TaggedStack<FreeBlock> depot_[size_classes];
+  inline static TaggedStack<Spare> spares_;
+  inline static std::atomic<Slab*> slabs_;
+
+  static size_t block_size(size_t bytes) { return std::max(min_block_size, (bytes + granularity - 1) / granularity * granularity); }
+
+  static size_t size_class(size_t bytes) { return (block_size(bytes) - min_block_size) / granularity; }
+
+  static bool is_cached(size_t bytes, size_t alignment) { return bytes <= max_block_size && alignment <= granularity; }
+
+  static LocalCache& local() {
+    static thread_local LocalCache cache;
+    static thread_local Flusher flusher;
+    return cache;
+  }
+
+  static void carve(LocalCache& cache, size_t size) {
+    if (Spare* spare = spares_.pop()) {
+      char* end = spare->end;
+      spare->~Spare();
+      if (static_cast<size_t>(end - reinterpret_cast<char*>(spare)) >= size) {
+        cache.ptr = reinterpret_cast<char*>(spare);
+        cache.end = end;
+        return;
+      }
+    }
+    Slab* slab = static_cast<Slab*>(::operator new(slab_size));
+    slab->next = slabs_.load(std::memory_order_relaxed);
+    while (!slabs_.compare_exchange_weak(slab->next, slab, std::memory_order_release, std::memory_order_relaxed)) {}
+    cache.ptr = reinterpret_cast<char*>(slab) + granularity;
+    cache.end = reinterpret_cast<char*>(slab) + slab_size;
+  }
+
+  static void retire(LocalCache& cache) {
+    for (size_t index = 0; index < size_classes; ++index) {
+      Magazine& magazine = cache.loaded[index];
+      if (magazine.count != 0) {
+        magazine.head->count = magazine.count;
+        depot_[index].push(magazine.head);
+        magazine = {nullptr, 0};
+      }
+    }
+    if (static_cast<size_t>(cache.end - cache.ptr) >= min_block_size) {
+      spares_.push(new (cache.ptr) Spare{{nullptr}, cache.end});
+    }
+    cache.ptr = nullptr;
+    cache.end = nullptr;
+  }
+
+  static void refill(LocalCache& cache, size_t index) {
+    if (FreeBlock* magazine = depot_[index].pop()) {
+      cache.loaded[index] = {magazine, magazine->count};
+      return;
+    }
+    size_t size = min_block_size + index * granularity;
+    if (static_cast<size_t>(cache.end - cache.ptr) < size) {
+      carve(cache, size);
+    }
+    size_t count = std::min(magazine_size, static_cast<size_t>(cache.end - cache.ptr) / size);
+    FreeBlock* head = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+      head = new (cache.ptr) FreeBlock{head, {nullptr}, 0};
+      cache.ptr += size;
+    }
+    cache.loaded[index] = {head, count};
+  }
+
+public:
+  static void* allocate(size_t bytes, size_t alignment) {
+    if (!is_cached(bytes, alignment)) {
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    LocalCache& cache = local();
+    size_t index = size_class(bytes);
+    if (cache.loaded[index].count == 0) {
+      refill(cache, index);
+    }
+    Magazine& magazine = cache.loaded[index];
+    FreeBlock* block = magazine.head;
+    magazine.head = block->next;
+    --magazine.count;
+    block->~FreeBlock();
+    if (cache.exited) {
+      retire(cache);
+    }
+    return block;
+  }
+
+  static void deallocate(void* ptr, size_t bytes, size_t alignment) {
+    if (!is_cached(bytes, alignment)) {
+      ::operator delete(ptr, std::align_val_t(alignment));
+      return;
+    }
+    LocalCache& cache = local();
+    size_t index = size_class(bytes);
+    Magazine& magazine = cache.loaded[index];
+    if (magazine.count == magazine_size) {
+      magazine.head->count = magazine.count;
+      depot_[index].push(magazine.head);
+      magazine = {nullptr, 0};
+    }
+    magazine.head = new (ptr) FreeBlock{magazine.head, {nullptr}, 0};
+    ++magazine.count;
+    if (cache.exited) {
+      retire(cache);
+    }
+  }
+};
@@ -1,49 +1,159 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
 #include <memory>
+#include <new>
+#include <stdexcept>
 
+#include "../List+StackAllocator/thread_cache.h"
 
-template <typename T>
+
+struct ThreadSafeCounting {
+  using Count = std::atomic<uint64_t>;
+
+
+  static void Add(Count& count, uint64_t delta) { count.fetch_add(delta, std::memory_order_relaxed); }
+
+  static bool TryAdd(Count& count, uint64_t delta, uint64_t mask) {
+    uint64_t value = count.load(std::memory_order_relaxed);
+    while ((value & mask) != 0) {
+      if (count.compare_exchange_weak(value, value + delta, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static uint64_t Sub(Count& count, uint64_t delta) { return count.fetch_sub(delta, std::memory_order_acq_rel); }
+
+  static uint64_t Load(const Count& count) { return count.load(std::memory_order_acquire); }
+};
+
+
+
+struct SingleThreadCounting {
+  using Count = uint64_t;
+
+
+  static void Add(Count& count, uint64_t delta) { count += delta; }
+
+  static bool TryAdd(Count& count, uint64_t delta, uint64_t mask) {
+    if ((count & mask) == 0) {
+      return false;
+    }
+    count += delta;
+    return true;
+  }
+
+  static uint64_t Sub(Count& count, uint64_t delta) {
+    uint64_t value = count;
+    count -= delta;
+    return value;
+  }
+
+  static uint64_t Load(const Count& count) { return count; }
+};
+
+
+
+template <typename T, typename Policy = ThreadSafeCounting>
 class SharedPtr;
 
-template <typename T>
+template <typename T, typename Policy = ThreadSafeCounting>
 class WeakPtr;
 
-template <typename T>
+template <typename T, typename Policy = ThreadSafeCounting>
 class EnableSharedFromThis;
 
+template <typename T>
+class AtomicSharedPtr;
+
+template <typename T, typename Policy = ThreadSafeCounting>
+class IntrusiveRefCounted;
 
+template <typename T>
+class IntrusivePtr;
 
+template <typename T>
+using LocalSharedPtr = SharedPtr<T, SingleThreadCounting>;
+
+template <typename T>
+using LocalWeakPtr = WeakPtr<T, SingleThreadCounting>;
+
+
+template <typename T, typename = void>
+struct is_intrusive : std::false_type {};
+
+template <typename T>
+struct is_intrusive<T, std::void_t<typename T::intrusive_base>> : std::true_type {};
+
+
+
+enum class ControlOperation { DeleteValue, Deallocate };
+
+
+
+template <typename Policy>
 struct BaseControlBlock {
-  size_t shared_count;
-  size_t weak_count;
+  using Manager = void (*)(BaseControlBlock*, ControlOperation);
+
+
+  static constexpr uint64_t kShared = 1;
+  static constexpr uint64_t kWeak = uint64_t(1) << 32;
+  static constexpr uint64_t kSharedMask = kWeak - 1;
 
 
-  BaseControlBlock() : shared_count(1), weak_count(0) {}
+  typename Policy::Count counts;
+  Manager manage;
+#ifdef SHAREDPTR_BOUNDS_CHECK
+  const void* array_begin = nullptr;
+  size_t array_bytes = 0;
+#endif
 
-  virtual ~BaseControlBlock() = default;
 
+  explicit BaseControlBlock(Manager manager) : counts(kShared + kWeak), manage(manager) {}
 
-  virtual void DeleteValue() = 0;
 
-  virtual void Deallocate() = 0;
+  void DeleteValue() {
+    if (manage != nullptr) {
+      manage(this, ControlOperation::DeleteValue);
+    }
+  }
+
+  void Deallocate() {
+    if (manage != nullptr) {
+      manage(this, ControlOperation::Deallocate);
+    } else {
+      ::operator delete(this);
+    }
+  }
+
 
+  size_t SharedCount() const { return Policy::Load(counts) & kSharedMask; }
 
-  void AddShared() { ++shared_count; }
+  void AddShared() { Policy::Add(counts, kShared); }
 
-  void AddWeak() { ++weak_count; }
+  void AddWeak() { Policy::Add(counts, kWeak); }
+
+  bool TryAddShared() { return Policy::TryAdd(counts, kShared, kSharedMask); }
 
   void DecreaseShared() {
-    --shared_count;
-    if (shared_count == 0) {
+    if (Policy::Load(counts) == kShared + kWeak) {
       DeleteValue();
-      if (weak_count == 0) {
-        Deallocate();
-      }
+      Deallocate();
+      return;
+    }
+    if ((Policy::Sub(counts, kShared) & kSharedMask) == 1) {
+      DeleteValue();
+      DecreaseWeak();
     }
   }
 
   void DecreaseWeak() {
-    --weak_count;
-    if (shared_count == 0 && weak_count == 0) {
+    if ((Policy::Sub(counts, kWeak) >> 32) == 1) {
       Deallocate();
     }
   }
@@ -52,10 +162,44 @@ struct BaseControlBlock {
 
 
 template <typename T>
+class PooledAllocator {
+public:
+  using value_type = T;
+
+
+  PooledAllocator() = default;
+
+  template <typename U>
+  PooledAllocator(const PooledAllocator<U>&) {}
+
+
+  T* allocate(size_t size) {
+    if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(ThreadCache::allocate(size * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t size) { ThreadCache::deallocate(ptr, size * sizeof(T), alignof(T)); }
+
+
+  template <typename U>
+  bool operator==(const PooledAllocator<U>&) const { return true; }
+
+  template <typename U>
+  bool operator!=(const PooledAllocator<U>&) const { return false; }
+};
+
+
+
+template <typename T, typename Policy>
 class SharedPtr {
+public:
+  using element_type = std::remove_extent_t<T>;
+
 private:
   template <typename N, typename Deleter, typename Alloc>
-  struct ControlBlock: BaseControlBlock {
+  struct ControlBlock: BaseControlBlock<Policy> {
     using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ControlBlock<N, Deleter, Alloc>>;
     using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ControlBlock<N, Deleter, Alloc>>;
 
@@ -65,79 +209,137 @@ private:
     [[no_unique_address]] Alloc alloc;
 
 
-    ControlBlock(N* val) : value(val) {}
+    ControlBlock(N* val) : BaseControlBlock<Policy>(&Manage), value(val) {}
 
-    ControlBlock(N* val, Deleter deleter) : value(val) {
-      try {
-        del = deleter;
-      } catch (...) {
-        try {
-          del = std::move(deleter);
-        }
-        catch (...) {
-          throw;
-        }
+    ControlBlock(N* val, Deleter deleter) : BaseControlBlock<Policy>(&Manage), value(val), del(std::move(deleter)) {}
+
+    ControlBlock(N* val, Deleter deleter, Alloc alloc) : BaseControlBlock<Policy>(&Manage), value(val), del(std::move(deleter)), alloc(alloc) {}
+
+
+    static void Manage(BaseControlBlock<Policy>* base, ControlOperation operation) {
+      ControlBlock* block = static_cast<ControlBlock*>(base);
+      if (operation == ControlOperation::DeleteValue) {
+        block->del(block->value);
+        return;
       }
+      Block_Alloc block_alloc(block->alloc);
+      block->~ControlBlock();
+      Block_Traits::deallocate(block_alloc, block, 1);
     }
+  };
 
-    ControlBlock(N* val, Deleter deleter, Alloc alloc) : value(val), alloc(alloc) {
-      try {
-        del = deleter;
-      } catch (...) {
-        try {
-          del = std::move(deleter);
-        }
-        catch (...) {
-          throw;
-        }
-      }
+
+
+  template <typename N, typename Alloc>
+  struct ControlBlockMakeShared: BaseControlBlock<Policy> {
+    using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ControlBlockMakeShared<N, Alloc>>;
+    using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ControlBlockMakeShared<N, Alloc>>;
+
+
+    alignas(N) char value[sizeof(N)];
+    [[no_unique_address]] Alloc alloc;
+
+
+    template <typename... Args>
+    ControlBlockMakeShared(Alloc alloc, Args&&... args) : BaseControlBlock<Policy>(SelectManager()), alloc(alloc) {
+      std::allocator_traits<Alloc>::construct(alloc, reinterpret_cast<N*>(value), std::forward<Args>(args)...);
     }
 
 
-    virtual ~ControlBlock() override = default;
+    static constexpr bool kTrivial = std::is_same_v<Alloc, std::allocator<typename Alloc::value_type>> &&
+                                     std::is_trivially_destructible_v<N> &&
+                                     alignof(N) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
 
+    static typename BaseControlBlock<Policy>::Manager SelectManager() { return kTrivial ? nullptr : &Manage; }
+
+    static void Manage(BaseControlBlock<Policy>* base, ControlOperation operation) {
+      ControlBlockMakeShared* block = static_cast<ControlBlockMakeShared*>(base);
+      if (operation == ControlOperation::DeleteValue) {
+        std::allocator_traits<Alloc>::destroy(block->alloc, reinterpret_cast<N*>(block->value));
+        return;
+      }
+      Block_Alloc block_alloc(block->alloc);
+      block->~ControlBlockMakeShared();
+      Block_Traits::deallocate(block_alloc, block, 1);
+    }
+  };
 
-    virtual void DeleteValue() override { del(value); }
 
-    virtual void Deallocate() override {
-      Block_Alloc block_alloc(alloc);
-      Block_Traits::deallocate(block_alloc, this, 1);
-    };
+
+  template <size_t Alignment>
+  struct alignas(Alignment) ArrayChunk {
+    char data[Alignment];
   };
 
 
 
   template <typename N, typename Alloc>
-  struct ControlBlockMakeShared: BaseControlBlock {
-    using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ControlBlockMakeShared<N, Alloc>>;
-    using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ControlBlockMakeShared<N, Alloc>>;
+  struct ControlBlockMakeSharedArray: BaseControlBlock<Policy> {
+    using Value_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<N>;
+    using Value_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<N>;
 
 
-    char value[sizeof(N)];
-    Alloc alloc;
+    size_t size;
+    [[no_unique_address]] Alloc alloc;
 
 
-    template <typename... Args>
-    ControlBlockMakeShared(Alloc alloc, Args&&... args) : alloc(alloc) {
-      std::allocator_traits<Alloc>::construct(alloc, reinterpret_cast<N*>(value), std::forward<Args>(args)...);
+    ControlBlockMakeSharedArray(Alloc alloc, size_t size) : BaseControlBlock<Policy>(SelectManager()), size(size), alloc(alloc) {}
+
+
+    static constexpr size_t Alignment() { return std::max(alignof(ControlBlockMakeSharedArray), alignof(N)); }
+
+    static constexpr size_t ElementsOffset() { return (sizeof(ControlBlockMakeSharedArray) + alignof(N) - 1) / alignof(N) * alignof(N); }
+
+    static size_t Chunks(size_t size) { return (ElementsOffset() + size * sizeof(N) + Alignment() - 1) / Alignment(); }
+
+    N* Elements() { return reinterpret_cast<N*>(reinterpret_cast<char*>(this) + ElementsOffset()); }
+
+    static typename BaseControlBlock<Policy>::Manager SelectManager() {
+      constexpr bool trivial = std::is_same_v<Alloc, std::allocator<typename Alloc::value_type>> &&
+                               std::is_trivially_destructible_v<N> &&
+                               Alignment() <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+      return trivial ? nullptr : &Manage;
     }
 
+    static void Manage(BaseControlBlock<Policy>* base, ControlOperation operation) {
+      using Chunk_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ArrayChunk<Alignment()>>;
+      using Chunk_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ArrayChunk<Alignment()>>;
+      ControlBlockMakeSharedArray* block = static_cast<ControlBlockMakeSharedArray*>(base);
+      if (operation == ControlOperation::DeleteValue) {
+        Value_Alloc value_alloc(block->alloc);
+        for (size_t i = block->size; i != 0; --i) {
+          Value_Traits::destroy(value_alloc, block->Elements() + i - 1);
+        }
+        return;
+      }
+      Chunk_Alloc chunk_alloc(block->alloc);
+      size_t chunks = Chunks(block->size);
+      block->~ControlBlockMakeSharedArray();
+      Chunk_Traits::deallocate(chunk_alloc, reinterpret_cast<ArrayChunk<Alignment()>*>(block), chunks);
+    }
+  };
+
 
-    virtual void DeleteValue() override { std::allocator_traits<Alloc>::destroy(alloc, reinterpret_cast<N*>(value)); }
 
-    virtual void Deallocate() override {
-      Block_Alloc block_alloc(alloc);
-      Block_Traits::deallocate(block_alloc, this, 1);
-    };
+  template <typename N>
+  struct IntrusiveRelease {
+    void operator()(N* ptr) const { N::intrusive_base::Release(ptr); }
   };
 
 
 
-  T* ptr_;
-  BaseControlBlock* block_;
+  element_type* ptr_;
+  BaseControlBlock<Policy>* block_;
+
+
+  SharedPtr(const WeakPtr<T, Policy>& weak);
+
 
+  template <typename Alloc, typename... Args>
+  static SharedPtr Allocate(const Alloc& alloc, Args&&... args);
 
-  SharedPtr(const WeakPtr<T>& weak);
+  template <typename Alloc, typename... Args>
+  static SharedPtr AllocateArray(const Alloc& alloc, size_t size, const Args&... args);
 
 public:
   SharedPtr();
@@ -155,40 +357,45 @@ public:
   SharedPtr(const SharedPtr& other);
 
   template <typename N>
-  SharedPtr(const SharedPtr<N>& other);
+  SharedPtr(const SharedPtr<N, Policy>& other);
 
-  SharedPtr(const SharedPtr&& other);
+  SharedPtr(SharedPtr&& other);
 
   template <typename N>
-  SharedPtr(SharedPtr<N>&& other);
+  SharedPtr(SharedPtr<N, Policy>&& other);
+
+  template <typename N>
+  SharedPtr(const IntrusivePtr<N>& other);
 
 
   template <typename N>
-  SharedPtr(const SharedPtr<N>& other, T* ptr);
+  SharedPtr(const SharedPtr<N, Policy>& other, element_type* ptr);
 
   template <typename N>
-  SharedPtr(SharedPtr<N>&& other, T* ptr);
+  SharedPtr(SharedPtr<N, Policy>&& other, element_type* ptr);
 
   SharedPtr& operator=(const SharedPtr& other);
 
   template <typename N>
-  SharedPtr& operator=(const SharedPtr<N>& other);
+  SharedPtr& operator=(const SharedPtr<N, Policy>& other);
 
-  SharedPtr& operator=(const SharedPtr&& other);
+  SharedPtr& operator=(SharedPtr&& other);
 
   template <typename N>
-  SharedPtr& operator=(SharedPtr<N>&& other);
+  SharedPtr& operator=(SharedPtr<N, Policy>&& other);
 
 
   ~SharedPtr();
 
 
 
-  T* get() const;
+  element_type* get() const;
 
-  T& operator*() const;
+  element_type& operator*() const;
 
-  T* operator->() const;
+  element_type* operator->() const;
+
+  element_type& operator[](ptrdiff_t index) const;
 
 
   long use_count() const;
@@ -208,55 +415,61 @@ public:
 
 
 
-  template <typename N, typename... Args>
-  friend SharedPtr<N> makeShared(Args&&... args);
-
   template <typename N, typename Alloc, typename... Args>
   friend SharedPtr<N> allocateShared(const Alloc& alloc, Args&&... args);
 
-  template <typename N>
+  template <typename N, typename Alloc, typename... Args>
+  friend LocalSharedPtr<N> allocateLocalShared(const Alloc& alloc, Args&&... args);
+
+  template <typename N, typename P>
   friend class SharedPtr;
 
-  template <typename N>
+  template <typename N, typename P>
   friend class WeakPtr;
+
+  template <typename N>
+  friend class AtomicSharedPtr;
 };
 
 
 
-template <typename T>
+template <typename T, typename Policy>
 class WeakPtr {
+public:
+  using element_type = std::remove_extent_t<T>;
+
 private:
-  T* ptr_;
-  BaseControlBlock* block_;
+  element_type* ptr_;
+  BaseControlBlock<Policy>* block_;
 
 
 public:
   WeakPtr();
 
   template <typename N>
-  WeakPtr(const SharedPtr<N>& other);
+  WeakPtr(const SharedPtr<N, Policy>& other);
 
 
   WeakPtr(const WeakPtr& other);
 
   template <typename N>
-  WeakPtr(const WeakPtr<N>& other);
+  WeakPtr(const WeakPtr<N, Policy>& other);
 
   WeakPtr(WeakPtr&& other);
 
   template <typename N>
-  WeakPtr(WeakPtr<N>&& other);
+  WeakPtr(WeakPtr<N, Policy>&& other);
 
 
   WeakPtr& operator=(const WeakPtr& other);
 
   template <typename N>
-  WeakPtr& operator=(const WeakPtr<N>& other);
+  WeakPtr& operator=(const WeakPtr<N, Policy>& other);
 
   WeakPtr& operator=(WeakPtr&& other);
 
   template <typename N>
-  WeakPtr& operator=(WeakPtr<N>&& other);
+  WeakPtr& operator=(WeakPtr<N, Policy>&& other);
 
 
   ~WeakPtr();
@@ -269,349 +482,887 @@ public:
 
   bool expired() const;
 
-  SharedPtr<T> lock() const;
+  SharedPtr<T, Policy> lock() const;
 
 
-  template <typename N>
+  template <typename N, typename P>
   friend class SharedPtr;
 
-  template <typename N>
+  template <typename N, typename P>
   friend class WeakPtr;
 };
 
 
 
-template <typename T>
+template <typename T, typename Policy>
 class EnableSharedFromThis {
-  WeakPtr<T> sptr_;
+  WeakPtr<T, Policy> sptr_;
 
 
 public:
-  SharedPtr<T> shared_from_this() const;
+  SharedPtr<T, Policy> shared_from_this() const;
 
 
-  template <typename N>
+  template <typename N, typename P>
   friend class SharedPtr;
 };
 
 
 
 template <typename T>
-SharedPtr<T>::SharedPtr() : ptr_(nullptr), block_(nullptr) {}
+class AtomicSharedPtr {
+private:
+  struct Node {
+    SharedPtr<T> value;
+    std::atomic<int64_t> count;
+
+
+    Node(SharedPtr<T>&& val) : value(std::move(val)), count(0) {}
+  };
+
+
+  static constexpr uint64_t kBorrow = uint64_t(1) << 48;
+  static constexpr uint64_t kPointerMask = kBorrow - 1;
+
+  static_assert(sizeof(uintptr_t) <= sizeof(uint64_t));
+
+
+  mutable std::atomic<uint64_t> word_;
+
+
+  static Node* ToNode(uint64_t word);
+
+  static uint64_t MakeWord(SharedPtr<T>&& value);
+
+  uint64_t Borrow() const;
+
+  void Release(Node* node) const;
+
+  static void Retire(uint64_t word, int64_t released);
+
+public:
+  AtomicSharedPtr();
+
+  AtomicSharedPtr(SharedPtr<T> desired);
+
+  AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+
+  AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+  AtomicSharedPtr& operator=(SharedPtr<T> desired);
+
+
+  ~AtomicSharedPtr();
+
+
+
+  bool is_lock_free() const;
+
+  SharedPtr<T> load() const;
+
+  operator SharedPtr<T>() const;
+
+  void store(SharedPtr<T> desired);
+
+  SharedPtr<T> exchange(SharedPtr<T> desired);
+
+  bool compare_exchange_weak(SharedPtr<T>& expected, SharedPtr<T> desired);
+
+  bool compare_exchange_strong(SharedPtr<T>& expected, SharedPtr<T> desired);
+};
+
+
+
+template <typename T, typename Policy>
+class IntrusiveRefCounted {
+private:
+  mutable typename Policy::Count ref_count_;
+
+
+  static void AddRef(const IntrusiveRefCounted* object);
+
+  static void Release(const IntrusiveRefCounted* object);
+
+protected:
+  IntrusiveRefCounted();
+
+  IntrusiveRefCounted(const IntrusiveRefCounted& other);
+
+  IntrusiveRefCounted& operator=(const IntrusiveRefCounted& other);
+
+  ~IntrusiveRefCounted() = default;
+
+public:
+  using intrusive_base = IntrusiveRefCounted;
+
+
+  long use_count() const;
+
+
+  template <typename N>
+  friend class IntrusivePtr;
+
+  template <typename N, typename P>
+  friend class SharedPtr;
+};
+
+
 
 template <typename T>
+class IntrusivePtr {
+private:
+  T* ptr_;
+
+
+public:
+  IntrusivePtr();
+
+  IntrusivePtr(T* ptr);
+
+  template <typename N, typename Policy>
+  explicit IntrusivePtr(const SharedPtr<N, Policy>& other);
+
+
+  IntrusivePtr(const IntrusivePtr& other);
+
+  template <typename N>
+  IntrusivePtr(const IntrusivePtr<N>& other);
+
+  IntrusivePtr(IntrusivePtr&& other);
+
+  template <typename N>
+  IntrusivePtr(IntrusivePtr<N>&& other);
+
+
+  IntrusivePtr& operator=(const IntrusivePtr& other);
+
+  template <typename N>
+  IntrusivePtr& operator=(const IntrusivePtr<N>& other);
+
+  IntrusivePtr& operator=(IntrusivePtr&& other);
+
+  template <typename N>
+  IntrusivePtr& operator=(IntrusivePtr<N>&& other);
+
+
+  ~IntrusivePtr();
+
+
+
+  T* get() const;
+
+  T& operator*() const;
+
+  T* operator->() const;
+
+
+  long use_count() const;
+
+  void reset();
+
+  void reset(T* ptr);
+
+  void swap(IntrusivePtr& other);
+
+
+  template <typename N>
+  friend class IntrusivePtr;
+};
+
+
+
+template <typename T, typename Policy>
+SharedPtr<T, Policy>::SharedPtr() : ptr_(nullptr), block_(nullptr) {}
+
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>::SharedPtr(N* ptr) : ptr_(ptr),  block_(new ControlBlock<N, std::default_delete<N>, std::allocator<N>>(ptr)) {
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
+SharedPtr<T, Policy>::SharedPtr(N* ptr) : ptr_(ptr), block_(nullptr) {
+  if constexpr (is_intrusive<N>::value) {
+    if (ptr == nullptr) {
+      return;
+    }
+    block_ = new ControlBlock<N, IntrusiveRelease<N>, std::allocator<N>>(ptr);
+    N::intrusive_base::AddRef(ptr);
+  } else {
+    using Delete = std::conditional_t<std::is_array_v<T>, std::default_delete<N[]>, std::default_delete<N>>;
+    block_ = new ControlBlock<N, Delete, std::allocator<N>>(ptr);
+  }
+  if constexpr (std::is_base_of_v<EnableSharedFromThis<T, Policy>, T>) {
     ptr_->sptr_ = *this;
   }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N, typename Deleter>
-SharedPtr<T>::SharedPtr(N* ptr, Deleter del) : ptr_(ptr),  block_(new ControlBlock<N, Deleter, std::allocator<N>>(ptr, del)) {
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
+SharedPtr<T, Policy>::SharedPtr(N* ptr, Deleter del) : ptr_(ptr),  block_(new ControlBlock<N, Deleter, std::allocator<N>>(ptr, del)) {
+  static_assert(!is_intrusive<N>::value);
+  if constexpr (std::is_base_of_v<EnableSharedFromThis<T, Policy>, T>) {
     ptr_->sptr_ = *this;
   }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N, typename Deleter, typename Alloc>
-SharedPtr<T>::SharedPtr(N* ptr, Deleter del, Alloc alloc) : ptr_(ptr) {
+SharedPtr<T, Policy>::SharedPtr(N* ptr, Deleter del, Alloc alloc) : ptr_(ptr) {
+  static_assert(!is_intrusive<N>::value);
   using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ControlBlock<N, Deleter, Alloc>>;
   using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ControlBlock<N, Deleter, Alloc>>;
-  using Block = typename SharedPtr<T>:: template ControlBlock<N, Deleter, Alloc>;
+  using Block = typename SharedPtr<T, Policy>:: template ControlBlock<N, Deleter, Alloc>;
   Block_Alloc block_alloc(alloc);
   Block* block(Block_Traits::allocate(block_alloc, 1));
-  new (block) typename SharedPtr<T>:: template ControlBlock<N, Deleter, Alloc>(ptr, del, alloc);
+  new (block) typename SharedPtr<T, Policy>:: template ControlBlock<N, Deleter, Alloc>(ptr, del, alloc);
   block_ = block;
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
+  if constexpr (std::is_base_of_v<EnableSharedFromThis<T, Policy>, T>) {
     ptr_->sptr_ = *this;
   }
 }
 
 
-template <typename T>
-SharedPtr<T>::SharedPtr(const SharedPtr& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+template <typename T, typename Policy>
+SharedPtr<T, Policy>::SharedPtr(const SharedPtr& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddShared();
   }
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
-  }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>::SharedPtr(const SharedPtr<N>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+SharedPtr<T, Policy>::SharedPtr(const SharedPtr<N, Policy>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddShared();
   }
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
-  }
 }
 
-template <typename T>
-SharedPtr<T>::SharedPtr(const SharedPtr&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+template <typename T, typename Policy>
+SharedPtr<T, Policy>::SharedPtr(SharedPtr&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   other.ptr_ = nullptr;
   other.block_ = nullptr;
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
-  }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>::SharedPtr(SharedPtr<N>&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+SharedPtr<T, Policy>::SharedPtr(SharedPtr<N, Policy>&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   other.ptr_ = nullptr;
   other.block_ = nullptr;
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
+}
+
+template <typename T, typename Policy>
+template <typename N>
+SharedPtr<T, Policy>::SharedPtr(const IntrusivePtr<N>& other) : ptr_(other.get()), block_(nullptr) {
+  if (ptr_ != nullptr) {
+    block_ = new ControlBlock<N, IntrusiveRelease<N>, std::allocator<N>>(other.get());
+    N::intrusive_base::AddRef(other.get());
   }
 }
 
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>::SharedPtr(const SharedPtr<N>& other, T* ptr) : ptr_(ptr), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+SharedPtr<T, Policy>::SharedPtr(const SharedPtr<N, Policy>& other, element_type* ptr) : ptr_(ptr), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddShared();
   }
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
-  }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>::SharedPtr(SharedPtr<N>&& other, T* ptr) : ptr_(ptr), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+SharedPtr<T, Policy>::SharedPtr(SharedPtr<N, Policy>&& other, element_type* ptr) : ptr_(ptr), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   other.ptr_ = nullptr;
   other.block_ = nullptr;
-  if constexpr (std::is_base_of_v<EnableSharedFromThis<T>, T>) {
-    ptr_->sptr_ = *this;
-  }
 }
 
 
-template <typename T>
-SharedPtr<T>& SharedPtr<T>::operator=(const SharedPtr& other) {
-  SharedPtr<T> copy(other);
+template <typename T, typename Policy>
+SharedPtr<T, Policy>& SharedPtr<T, Policy>::operator=(const SharedPtr& other) {
+  SharedPtr<T, Policy> copy(other);
   swap(copy);
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>& SharedPtr<T>::operator=(const SharedPtr<N>& other) {
-  SharedPtr<T> copy(other);
+SharedPtr<T, Policy>& SharedPtr<T, Policy>::operator=(const SharedPtr<N, Policy>& other) {
+  SharedPtr<T, Policy> copy(other);
   swap(copy);
   return *this;
 }
 
-template <typename T>
-SharedPtr<T>& SharedPtr<T>::operator=(const SharedPtr&& other) {
-  SharedPtr<T> copy(std::move(other));
+template <typename T, typename Policy>
+SharedPtr<T, Policy>& SharedPtr<T, Policy>::operator=(SharedPtr&& other) {
+  SharedPtr<T, Policy> copy(std::move(other));
   swap(copy);
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-SharedPtr<T>& SharedPtr<T>::operator=(SharedPtr<N>&& other) {
-  SharedPtr<T> copy(std::move(other));
+SharedPtr<T, Policy>& SharedPtr<T, Policy>::operator=(SharedPtr<N, Policy>&& other) {
+  SharedPtr<T, Policy> copy(std::move(other));
   swap(copy);
   return *this;
 }
 
 
-template <typename T>
-SharedPtr<T>::~SharedPtr() {
+template <typename T, typename Policy>
+SharedPtr<T, Policy>::~SharedPtr() {
   if (block_ != nullptr) {
     block_->DecreaseShared();
   }
 }
 
 
-template <typename T>
-T* SharedPtr<T>::get() const { return ptr_; }
+template <typename T, typename Policy>
+typename SharedPtr<T, Policy>::element_type* SharedPtr<T, Policy>::get() const { return ptr_; }
 
-template <typename T>
-T& SharedPtr<T>::operator*() const { return *ptr_;}
+template <typename T, typename Policy>
+typename SharedPtr<T, Policy>::element_type& SharedPtr<T, Policy>::operator*() const { return *ptr_;}
 
-template <typename T>
-T* SharedPtr<T>::operator->() const { return ptr_; }
+template <typename T, typename Policy>
+typename SharedPtr<T, Policy>::element_type* SharedPtr<T, Policy>::operator->() const { return ptr_; }
+
+template <typename T, typename Policy>
+typename SharedPtr<T, Policy>::element_type& SharedPtr<T, Policy>::operator[](ptrdiff_t index) const {
+  static_assert(std::is_array_v<T>);
+#ifdef SHAREDPTR_BOUNDS_CHECK
+  if (block_ != nullptr && block_->array_begin != nullptr) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(block_->array_begin);
+    uintptr_t element = reinterpret_cast<uintptr_t>(ptr_) + index * static_cast<ptrdiff_t>(sizeof(element_type));
+    if (element < begin || element + sizeof(element_type) > begin + block_->array_bytes) {
+      throw std::out_of_range("SharedPtr::operator[]");
+    }
+  }
+#endif
+  return ptr_[index];
+}
 
 
-template <typename T>
-long SharedPtr<T>::use_count() const {
+template <typename T, typename Policy>
+long SharedPtr<T, Policy>::use_count() const {
   if (block_ == nullptr) {
     return 0;
   }
-  return block_->shared_count;
+  return block_->SharedCount();
 }
 
-template <typename T>
-void SharedPtr<T>::reset() {
+template <typename T, typename Policy>
+void SharedPtr<T, Policy>::reset() {
   *this = SharedPtr();
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-void SharedPtr<T>::reset(N* ptr) {
+void SharedPtr<T, Policy>::reset(N* ptr) {
   *this = SharedPtr(ptr);
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N, typename Deleter>
-void SharedPtr<T>::reset(N* ptr, Deleter del) {
+void SharedPtr<T, Policy>::reset(N* ptr, Deleter del) {
   *this = SharedPtr(ptr, del);
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N, typename Deleter, typename Alloc>
-void SharedPtr<T>::reset(N* ptr, Deleter del, Alloc alloc) {
+void SharedPtr<T, Policy>::reset(N* ptr, Deleter del, Alloc alloc) {
   *this = SharedPtr(ptr, del, alloc);
 }
 
-template <typename T>
-void SharedPtr<T>::swap(SharedPtr& other) {
+template <typename T, typename Policy>
+void SharedPtr<T, Policy>::swap(SharedPtr& other) {
   std::swap(block_, other.block_);
   std::swap(ptr_, other.ptr_);
 }
 
 
-template <typename T, typename Alloc, typename... Args>
-SharedPtr<T> allocateShared(const Alloc& alloc, Args&&... args) {
-  using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<typename SharedPtr<T>:: template ControlBlockMakeShared<T, Alloc>>;
-  using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<typename SharedPtr<T>:: template ControlBlockMakeShared<T, Alloc>>;
-  using Block = typename SharedPtr<T>:: template ControlBlockMakeShared<T, Alloc>;
-  Block_Alloc block_alloc(alloc);
-  Block* block(Block_Traits::allocate(block_alloc, 1));
-  new (block) typename SharedPtr<T>:: template ControlBlockMakeShared<T, Alloc>(alloc, std::forward<Args>(args)...);
-  SharedPtr<T> res;
+template <typename T, typename Policy>
+template <typename Alloc, typename... Args>
+SharedPtr<T, Policy> SharedPtr<T, Policy>::Allocate(const Alloc& alloc, Args&&... args) {
+  if constexpr (std::is_array_v<T>) {
+    return AllocateArray(alloc, std::forward<Args>(args)...);
+  } else {
+    static_assert(!is_intrusive<T>::value);
+    using Block_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ControlBlockMakeShared<T, Alloc>>;
+    using Block_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ControlBlockMakeShared<T, Alloc>>;
+    using Block = ControlBlockMakeShared<T, Alloc>;
+    Block_Alloc block_alloc(alloc);
+    Block* block(Block_Traits::allocate(block_alloc, 1));
+    try {
+      new (block) Block(alloc, std::forward<Args>(args)...);
+    } catch (...) {
+      Block_Traits::deallocate(block_alloc, block, 1);
+      throw;
+    }
+    SharedPtr<T, Policy> res;
+    res.block_ = block;
+    res.ptr_ = reinterpret_cast<T*>(block->value);
+    if constexpr (std::is_base_of_v<EnableSharedFromThis<T, Policy>, T>) {
+      res.ptr_->sptr_ = res;
+    }
+    return res;
+  }
+}
+
+template <typename T, typename Policy>
+template <typename Alloc, typename... Args>
+SharedPtr<T, Policy> SharedPtr<T, Policy>::AllocateArray(const Alloc& alloc, size_t size, const Args&... args) {
+  static_assert(std::extent_v<T> == 0 && sizeof...(Args) <= 1);
+  using Block = ControlBlockMakeSharedArray<element_type, Alloc>;
+  using Chunk_Alloc = typename std::allocator_traits<Alloc>:: template rebind_alloc<ArrayChunk<Block::Alignment()>>;
+  using Chunk_Traits = typename std::allocator_traits<Alloc>:: template rebind_traits<ArrayChunk<Block::Alignment()>>;
+  using Value_Traits = typename Block::Value_Traits;
+  if (size > (std::numeric_limits<size_t>::max() - Block::ElementsOffset() - Block::Alignment()) / sizeof(element_type)) {
+    throw std::bad_array_new_length();
+  }
+  Chunk_Alloc chunk_alloc(alloc);
+  size_t chunks = Block::Chunks(size);
+  Block* block = reinterpret_cast<Block*>(Chunk_Traits::allocate(chunk_alloc, chunks));
+  new (block) Block(alloc, size);
+  typename Block::Value_Alloc value_alloc(alloc);
+  element_type* elements = block->Elements();
+  size_t constructed = 0;
+  try {
+    for (; constructed < size; ++constructed) {
+      Value_Traits::construct(value_alloc, elements + constructed, args...);
+    }
+  } catch (...) {
+    while (constructed != 0) {
+      Value_Traits::destroy(value_alloc, elements + --constructed);
+    }
+    block->~Block();
+    Chunk_Traits::deallocate(chunk_alloc, reinterpret_cast<ArrayChunk<Block::Alignment()>*>(block), chunks);
+    throw;
+  }
+#ifdef SHAREDPTR_BOUNDS_CHECK
+  block->array_begin = elements;
+  block->array_bytes = size * sizeof(element_type);
+#endif
+  SharedPtr<T, Policy> res;
   res.block_ = block;
-  res.ptr_ = reinterpret_cast<T*>(block->value);
+  res.ptr_ = elements;
   return res;
 }
 
+template <typename T, typename Alloc, typename... Args>
+SharedPtr<T> allocateShared(const Alloc& alloc, Args&&... args) {
+  return SharedPtr<T>::Allocate(alloc, std::forward<Args>(args)...);
+}
+
 template <typename T, typename... Args>
 SharedPtr<T> makeShared(Args&&... args) {
-  return SharedPtr<T>(allocateShared<T>(std::allocator<T>(), std::forward<Args>(args)...));
+  return allocateShared<T>(std::allocator<std::remove_extent_t<T>>(), std::forward<Args>(args)...);
 }
 
+template <typename T, typename... Args>
+SharedPtr<T> makeSharedPooled(Args&&... args) {
+  return allocateShared<T>(PooledAllocator<std::remove_extent_t<T>>(), std::forward<Args>(args)...);
+}
 
-template <typename T>
-SharedPtr<T>::SharedPtr(const WeakPtr<T>& weak) : ptr_(weak.ptr_), block_(reinterpret_cast<BaseControlBlock*>(weak.block_)) {
-  if (block_ != nullptr) {
-    block_->AddShared();
+template <typename T, typename Alloc, typename... Args>
+LocalSharedPtr<T> allocateLocalShared(const Alloc& alloc, Args&&... args) {
+  return LocalSharedPtr<T>::Allocate(alloc, std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+LocalSharedPtr<T> makeLocalShared(Args&&... args) {
+  return allocateLocalShared<T>(std::allocator<std::remove_extent_t<T>>(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+LocalSharedPtr<T> makeLocalSharedPooled(Args&&... args) {
+  return allocateLocalShared<T>(PooledAllocator<std::remove_extent_t<T>>(), std::forward<Args>(args)...);
+}
+
+
+template <typename T, typename Policy>
+SharedPtr<T, Policy>::SharedPtr(const WeakPtr<T, Policy>& weak) : ptr_(nullptr), block_(nullptr) {
+  if (weak.block_ != nullptr && weak.block_->TryAddShared()) {
+    ptr_ = weak.ptr_;
+    block_ = weak.block_;
   }
 }
 
 
 
-template <typename T>
-WeakPtr<T>::WeakPtr() : ptr_(nullptr), block_(nullptr) {}
+template <typename T, typename Policy>
+WeakPtr<T, Policy>::WeakPtr() : ptr_(nullptr), block_(nullptr) {}
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-WeakPtr<T>::WeakPtr(const SharedPtr<N>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+WeakPtr<T, Policy>::WeakPtr(const SharedPtr<N, Policy>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddWeak();
   }
 }
 
 
-template <typename T>
-WeakPtr<T>::WeakPtr(const WeakPtr& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+template <typename T, typename Policy>
+WeakPtr<T, Policy>::WeakPtr(const WeakPtr& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddWeak();
   }
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-WeakPtr<T>::WeakPtr(const WeakPtr<N>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+WeakPtr<T, Policy>::WeakPtr(const WeakPtr<N, Policy>& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   if (block_ != nullptr) {
     block_->AddWeak();
   }
 }
 
-template <typename T>
-WeakPtr<T>::WeakPtr(WeakPtr&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+template <typename T, typename Policy>
+WeakPtr<T, Policy>::WeakPtr(WeakPtr&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   other.ptr_ = nullptr;
   other.block_ = nullptr;
 }
 
-template <typename T>
+template <typename T, typename Policy>
 template <typename N>
-WeakPtr<T>::WeakPtr(WeakPtr<N>&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock*>(other.block_)) {
+WeakPtr<T, Policy>::WeakPtr(WeakPtr<N, Policy>&& other) : ptr_(other.ptr_), block_(reinterpret_cast<BaseControlBlock<Policy>*>(other.block_)) {
   other.ptr_ = nullptr;
   other.block_ = nullptr;
 }
 
 
+template <typename T, typename Policy>
+WeakPtr<T, Policy>& WeakPtr<T, Policy>::operator=(const WeakPtr& other) {
+  WeakPtr<T, Policy> copy(other);
+  swap(copy);
+  return *this;
+}
+
+template <typename T, typename Policy>
+template <typename N>
+WeakPtr<T, Policy>& WeakPtr<T, Policy>::operator=(const WeakPtr<N, Policy>& other) {
+  WeakPtr<T, Policy> copy(other);
+  swap(copy);
+  return *this;
+}
+
+template <typename T, typename Policy>
+WeakPtr<T, Policy>& WeakPtr<T, Policy>::operator=(WeakPtr&& other) {
+  WeakPtr<T, Policy> copy(std::move(other));
+  swap(copy);
+  return *this;
+}
+
+template <typename T, typename Policy>
+template <typename N>
+WeakPtr<T, Policy>& WeakPtr<T, Policy>::operator=(WeakPtr<N, Policy>&& other) {
+  WeakPtr<T, Policy> copy(std::move(other));
+  swap(copy);
+  return *this;
+}
+
+
+template <typename T, typename Policy>
+WeakPtr<T, Policy>::~WeakPtr() {
+  if (block_ != nullptr) {
+    block_->DecreaseWeak();
+  }
+}
+
+
+template <typename T, typename Policy>
+void WeakPtr<T, Policy>::swap(WeakPtr& other) {
+  std::swap(block_, other.block_);
+  std::swap(ptr_, other.ptr_);
+}
+
+template <typename T, typename Policy>
+long WeakPtr<T, Policy>::use_count() const {
+  if (block_ == nullptr) {
+    return 0;
+  }
+  return block_->SharedCount();
+}
+
+template <typename T, typename Policy>
+bool WeakPtr<T, Policy>::expired() const { return (use_count() == 0); }
+
+template <typename T, typename Policy>
+SharedPtr<T, Policy> WeakPtr<T, Policy>::lock() const { return SharedPtr<T, Policy>(*this); }
+
+
+template <typename T, typename Policy>
+SharedPtr<T, Policy> EnableSharedFromThis<T, Policy>::shared_from_this() const {
+  SharedPtr<T, Policy> res = sptr_.lock();
+  if (res.get() == nullptr) {
+    throw std::bad_weak_ptr();
+  }
+  return res;
+}
+
+
+
+template <typename T>
+typename AtomicSharedPtr<T>::Node* AtomicSharedPtr<T>::ToNode(uint64_t word) {
+  return reinterpret_cast<Node*>(static_cast<uintptr_t>(word & kPointerMask));
+}
+
+template <typename T>
+uint64_t AtomicSharedPtr<T>::MakeWord(SharedPtr<T>&& value) {
+  if (value.block_ == nullptr && value.ptr_ == nullptr) {
+    return 0;
+  }
+  uint64_t word = reinterpret_cast<uintptr_t>(new Node(std::move(value)));
+  if ((word & ~kPointerMask) != 0) {
+    std::abort();
+  }
+  return word;
+}
+
+template <typename T>
+uint64_t AtomicSharedPtr<T>::Borrow() const {
+  uint64_t word = word_.load(std::memory_order_acquire);
+  while (ToNode(word) != nullptr &&
+         !word_.compare_exchange_weak(word, word + kBorrow, std::memory_order_acq_rel, std::memory_order_acquire)) {}
+  return ToNode(word) == nullptr ? word : word + kBorrow;
+}
+
+template <typename T>
+void AtomicSharedPtr<T>::Release(Node* node) const {
+  uint64_t word = word_.load(std::memory_order_acquire);
+  while (ToNode(word) == node) {
+    if (word_.compare_exchange_weak(word, word - kBorrow, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      return;
+    }
+  }
+  if (node->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete node;
+  }
+}
+
+template <typename T>
+void AtomicSharedPtr<T>::Retire(uint64_t word, int64_t released) {
+  Node* node = ToNode(word);
+  if (node == nullptr) {
+    return;
+  }
+  int64_t borrowed = static_cast<int64_t>(word >> 48) - released;
+  if (node->count.fetch_add(borrowed, std::memory_order_acq_rel) == -borrowed) {
+    delete node;
+  }
+}
+
+
+template <typename T>
+AtomicSharedPtr<T>::AtomicSharedPtr() : word_(0) {}
+
+template <typename T>
+AtomicSharedPtr<T>::AtomicSharedPtr(SharedPtr<T> desired) : word_(MakeWord(std::move(desired))) {}
+
 template <typename T>
-WeakPtr<T>& WeakPtr<T>::operator=(const WeakPtr& other) {
-  WeakPtr<T> copy(other);
+AtomicSharedPtr<T>& AtomicSharedPtr<T>::operator=(SharedPtr<T> desired) {
+  store(std::move(desired));
+  return *this;
+}
+
+
+template <typename T>
+AtomicSharedPtr<T>::~AtomicSharedPtr() {
+  Retire(word_.load(std::memory_order_acquire), 0);
+}
+
+
+template <typename T>
+bool AtomicSharedPtr<T>::is_lock_free() const { return word_.is_lock_free(); }
+
+template <typename T>
+SharedPtr<T> AtomicSharedPtr<T>::load() const {
+  Node* node = ToNode(Borrow());
+  if (node == nullptr) {
+    return SharedPtr<T>();
+  }
+  SharedPtr<T> res = node->value;
+  Release(node);
+  return res;
+}
+
+template <typename T>
+AtomicSharedPtr<T>::operator SharedPtr<T>() const { return load(); }
+
+template <typename T>
+void AtomicSharedPtr<T>::store(SharedPtr<T> desired) {
+  exchange(std::move(desired));
+}
+
+template <typename T>
+SharedPtr<T> AtomicSharedPtr<T>::exchange(SharedPtr<T> desired) {
+  uint64_t word = word_.exchange(MakeWord(std::move(desired)), std::memory_order_acq_rel);
+  Node* node = ToNode(word);
+  if (node == nullptr) {
+    return SharedPtr<T>();
+  }
+  SharedPtr<T> res = node->value;
+  Retire(word, 0);
+  return res;
+}
+
+template <typename T>
+bool AtomicSharedPtr<T>::compare_exchange_weak(SharedPtr<T>& expected, SharedPtr<T> desired) {
+  return compare_exchange_strong(expected, std::move(desired));
+}
+
+template <typename T>
+bool AtomicSharedPtr<T>::compare_exchange_strong(SharedPtr<T>& expected, SharedPtr<T> desired) {
+  uint64_t desired_word = MakeWord(std::move(desired));
+  while (true) {
+    uint64_t word = Borrow();
+    Node* node = ToNode(word);
+    bool equal = (node == nullptr) ? (expected.block_ == nullptr && expected.ptr_ == nullptr)
+                                   : (expected.block_ == node->value.block_ && expected.ptr_ == node->value.ptr_);
+    if (!equal) {
+      expected = (node == nullptr) ? SharedPtr<T>() : node->value;
+      if (node != nullptr) {
+        Release(node);
+      }
+      Retire(desired_word, 0);
+      return false;
+    }
+    if (word_.compare_exchange_strong(word, desired_word, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      Retire(word, 1);
+      return true;
+    }
+    if (node != nullptr) {
+      Release(node);
+    }
+  }
+}
+
+
+
+template <typename T, typename Policy>
+IntrusiveRefCounted<T, Policy>::IntrusiveRefCounted() : ref_count_(0) {}
+
+template <typename T, typename Policy>
+IntrusiveRefCounted<T, Policy>::IntrusiveRefCounted(const IntrusiveRefCounted&) : ref_count_(0) {}
+
+template <typename T, typename Policy>
+IntrusiveRefCounted<T, Policy>& IntrusiveRefCounted<T, Policy>::operator=(const IntrusiveRefCounted&) { return *this; }
+
+
+template <typename T, typename Policy>
+void IntrusiveRefCounted<T, Policy>::AddRef(const IntrusiveRefCounted* object) { Policy::Add(object->ref_count_, 1); }
+
+template <typename T, typename Policy>
+void IntrusiveRefCounted<T, Policy>::Release(const IntrusiveRefCounted* object) {
+  if (Policy::Sub(object->ref_count_, 1) == 1) {
+    delete static_cast<const T*>(object);
+  }
+}
+
+template <typename T, typename Policy>
+long IntrusiveRefCounted<T, Policy>::use_count() const { return Policy::Load(ref_count_); }
+
+
+
+template <typename T>
+IntrusivePtr<T>::IntrusivePtr() : ptr_(nullptr) {}
+
+template <typename T>
+IntrusivePtr<T>::IntrusivePtr(T* ptr) : ptr_(ptr) {
+  if (ptr_ != nullptr) {
+    T::intrusive_base::AddRef(ptr_);
+  }
+}
+
+template <typename T>
+template <typename N, typename Policy>
+IntrusivePtr<T>::IntrusivePtr(const SharedPtr<N, Policy>& other) : IntrusivePtr(other.get()) {}
+
+
+template <typename T>
+IntrusivePtr<T>::IntrusivePtr(const IntrusivePtr& other) : IntrusivePtr(other.ptr_) {}
+
+template <typename T>
+template <typename N>
+IntrusivePtr<T>::IntrusivePtr(const IntrusivePtr<N>& other) : IntrusivePtr(other.ptr_) {}
+
+template <typename T>
+IntrusivePtr<T>::IntrusivePtr(IntrusivePtr&& other) : ptr_(other.ptr_) {
+  other.ptr_ = nullptr;
+}
+
+template <typename T>
+template <typename N>
+IntrusivePtr<T>::IntrusivePtr(IntrusivePtr<N>&& other) : ptr_(other.ptr_) {
+  other.ptr_ = nullptr;
+}
+
+
+template <typename T>
+IntrusivePtr<T>& IntrusivePtr<T>::operator=(const IntrusivePtr& other) {
+  IntrusivePtr<T> copy(other);
   swap(copy);
   return *this;
 }
 
 template <typename T>
 template <typename N>
-WeakPtr<T>& WeakPtr<T>::operator=(const WeakPtr<N>& other) {
-  WeakPtr<T> copy(other);
+IntrusivePtr<T>& IntrusivePtr<T>::operator=(const IntrusivePtr<N>& other) {
+  IntrusivePtr<T> copy(other);
   swap(copy);
   return *this;
 }
 
 template <typename T>
-WeakPtr<T>& WeakPtr<T>::operator=(WeakPtr&& other) {
-  WeakPtr<T> copy(std::move(other));
+IntrusivePtr<T>& IntrusivePtr<T>::operator=(IntrusivePtr&& other) {
+  IntrusivePtr<T> copy(std::move(other));
   swap(copy);
   return *this;
 }
 
 template <typename T>
 template <typename N>
-WeakPtr<T>& WeakPtr<T>::operator=(WeakPtr<N>&& other) {
-  WeakPtr<T> copy(std::move(other));
+IntrusivePtr<T>& IntrusivePtr<T>::operator=(IntrusivePtr<N>&& other) {
+  IntrusivePtr<T> copy(std::move(other));
   swap(copy);
   return *this;
 }
 
 
 template <typename T>
-WeakPtr<T>::~WeakPtr() {
-  if (block_ != nullptr) {
-    block_->DecreaseWeak();
+IntrusivePtr<T>::~IntrusivePtr() {
+  if (ptr_ != nullptr) {
+    T::intrusive_base::Release(ptr_);
   }
 }
 
 
 template <typename T>
-void WeakPtr<T>::swap(WeakPtr& other) { std::swap(block_, other.block_); }
+T* IntrusivePtr<T>::get() const { return ptr_; }
 
 template <typename T>
-long WeakPtr<T>::use_count() const { return block_->shared_count; }
+T& IntrusivePtr<T>::operator*() const { return *ptr_; }
 
 template <typename T>
-bool WeakPtr<T>::expired() const { return (block_->shared_count == 0); }
+T* IntrusivePtr<T>::operator->() const { return ptr_; }
+
 
 template <typename T>
-SharedPtr<T> WeakPtr<T>::lock() const {
-  if (expired()) {
-    return SharedPtr<T>();
+long IntrusivePtr<T>::use_count() const {
+  if (ptr_ == nullptr) {
+    return 0;
   }
-  return SharedPtr<T>(*this);
+  return ptr_->use_count();
 }
 
+template <typename T>
+void IntrusivePtr<T>::reset() {
+  *this = IntrusivePtr();
+}
 
 template <typename T>
-SharedPtr<T> EnableSharedFromThis<T>::shared_from_this() const {
-  if (sptr_.expired()) {
-    return std::bad_weak_ptr();
-  }
-  return sptr_.lock();
+void IntrusivePtr<T>::reset(T* ptr) {
+  *this = IntrusivePtr(ptr);
+}
+
+template <typename T>
+void IntrusivePtr<T>::swap(IntrusivePtr& other) { std::swap(ptr_, other.ptr_); }
+
+
+template <typename T, typename... Args>
+IntrusivePtr<T> makeIntrusive(Args&&... args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
 }
@@ -0,0 +1,139 @@
+#include "shareptr.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+constexpr int kThreads = 4;
+constexpr int kIterations = 20000;
+
+std::atomic<int> alive{0};
+
+struct Tracked {
+  int value;
+
+  explicit Tracked(int val) : value(val) { alive.fetch_add(1, std::memory_order_relaxed); }
+
+  ~Tracked() { alive.fetch_sub(1, std::memory_order_relaxed); }
+};
+
+
+struct Intrusive : IntrusiveRefCounted<Intrusive> {
+  Tracked tracked{0};
+};
+
+
+template <typename Body>
+void RunThreads(Body body) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back(body, i);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+
+void TestConcurrentCopyAndDestroy() {
+  {
+    SharedPtr<Tracked> shared = makeShared<Tracked>(7);
+    RunThreads([&shared](int) {
+      for (int i = 0; i < kIterations; ++i) {
+        SharedPtr<Tracked> copy = shared;
+        WeakPtr<Tracked> weak = copy;
+        SharedPtr<Tracked> moved = std::move(copy);
+        assert(moved->value == 7);
+        assert(!weak.expired());
+      }
+    });
+    assert(shared.use_count() == 1);
+  }
+  assert(alive.load() == 0);
+}
+
+
+void TestLockRacingLastRelease() {
+  for (int i = 0; i < kIterations / 10; ++i) {
+    SharedPtr<Tracked> owner = makeShared<Tracked>(i);
+    WeakPtr<Tracked> weak = owner;
+    std::atomic<bool> start{false};
+    std::thread releaser([&owner, &start] {
+      while (!start.load(std::memory_order_acquire)) {}
+      owner.reset();
+    });
+    start.store(true, std::memory_order_release);
+    SharedPtr<Tracked> locked = weak.lock();
+    if (locked.get() != nullptr) {
+      assert(locked->value == i);
+      assert(alive.load() == 1);
+    }
+    releaser.join();
+    locked.reset();
+    assert(weak.expired());
+    assert(weak.lock().get() == nullptr);
+    assert(alive.load() == 0);
+  }
+}
+
+
+void TestAtomicSharedPtr() {
+  {
+    AtomicSharedPtr<Tracked> counter(makeShared<Tracked>(0));
+    AtomicSharedPtr<Tracked> latest;
+    RunThreads([&counter, &latest](int id) {
+      for (int i = 0; i < kIterations; ++i) {
+        SharedPtr<Tracked> expected = counter.load();
+        assert(expected.get() != nullptr);
+        while (true) {
+          SharedPtr<Tracked> desired = makeShared<Tracked>(expected->value + 1);
+          if (counter.compare_exchange_strong(expected, desired)) {
+            latest.store(desired);
+            break;
+          }
+          assert(expected.get() != nullptr);
+        }
+        SharedPtr<Tracked> seen = latest.load();
+        if (seen.get() != nullptr) {
+          assert(seen->value > 0);
+        }
+        if (id == 0 && i % 64 == 0) {
+          latest.store(SharedPtr<Tracked>());
+        }
+      }
+    });
+    assert(counter.load()->value == kThreads * kIterations);
+  }
+  assert(alive.load() == 0);
+}
+
+
+void TestIntrusiveNull() {
+  {
+    SharedPtr<Intrusive> null(static_cast<Intrusive*>(nullptr));
+    SharedPtr<Intrusive> copy = null;
+    assert(copy.get() == nullptr);
+    assert(copy.use_count() == 0);
+    SharedPtr<Intrusive> owner(new Intrusive());
+    SharedPtr<Intrusive> shared = owner;
+    assert(shared.get() == owner.get());
+    assert(alive.load() == 1);
+  }
+  assert(alive.load() == 0);
+}
+
+}
+
+
+int main() {
+  TestConcurrentCopyAndDestroy();
+  TestLockRacingLastRelease();
+  TestAtomicSharedPtr();
+  TestIntrusiveNull();
+  std::puts("OK");
+}
@@ -1,56 +1,107 @@
 #include <iostream>
 #include <cstring>
+#include <memory>
 
-class String {
+template <typename Alloc = std::allocator<char>>
+class BasicString {
  private:
+  using AllocTraits = std::allocator_traits<Alloc>;
+
+  [[no_unique_address]] Alloc alloc_;
   char* array = nullptr;
   size_t size_of_string = 0;
   size_t size_of_memory = 0;
 
-  String(size_t length): array(new char[length + 1]), size_of_string(length), size_of_memory(length + 1) {
+  BasicString(size_t length, const Alloc& alloc, int): alloc_(alloc), array(AllocTraits::allocate(alloc_, length + 1)), size_of_string(length), size_of_memory(length + 1) {
     array[size_of_string] = 0;
   }
 
+  BasicString(const BasicString& string, const Alloc& alloc, int): BasicString(string.size_of_string, alloc, 0) {
+    memcpy(array, string.array, size_of_string);
+  }
+
+  void swap_with_allocator(BasicString& string) {
+    std::swap(alloc_, string.alloc_);
+    std::swap(array, string.array);
+    std::swap(size_of_string, string.size_of_string);
+    std::swap(size_of_memory, string.size_of_memory);
+  }
+
  public:
-  String(): array(new char[1]), size_of_string(0), size_of_memory(1) {}
+  using allocator_type = Alloc;
+
+  BasicString(): BasicString(0, Alloc(), 0) {}
+
+  explicit BasicString(const Alloc& alloc): BasicString(0, alloc, 0) {}
 
-  String(char symbol): array(new char[2]), size_of_string(1), size_of_memory(2) {
+  BasicString(char symbol, const Alloc& alloc = Alloc()): BasicString(1, alloc, 0) {
     array[0] = symbol;
-    array[1] = 0;
   }
 
-  String (const char* string): String(strlen(string)) {
+  BasicString (const char* string, const Alloc& alloc = Alloc()): BasicString(strlen(string), alloc, 0) {
     memcpy(array, string, size_of_string);
   }
 
-  String (size_t length, char c): String(length) {
+  BasicString (size_t length, char c, const Alloc& alloc = Alloc()): BasicString(length, alloc, 0) {
     memset(array, c, length);
   }
 
-  String (const String& string): String(string.size_of_string) {
-    memcpy(array, string.array, size_of_string);
+  BasicString (const BasicString& string): BasicString(string, AllocTraits::select_on_container_copy_construction(string.alloc_), 0) {}
+
+  ~BasicString() {
+    AllocTraits::deallocate(alloc_, array, size_of_memory);
   }
 
-  ~String() {
-    delete[] array;
+  BasicString& operator=(const BasicString& string) {
+    if (this == &string) {
+      return *this;
+    }
+    if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+      BasicString copy(string, string.alloc_, 0);
+      swap_with_allocator(copy);
+    } else {
+      BasicString copy(string, alloc_, 0);
+      swap_with_allocator(copy);
+    }
+    return *this;
   }
 
-  String& operator=(String string) {
-    swap(string);
+  BasicString& operator=(BasicString&& string) {
+    if (this == &string) {
+      return *this;
+    }
+    if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+      swap_with_allocator(string);
+    } else {
+      if (alloc_ == string.alloc_) {
+        swap_with_allocator(string);
+      } else {
+        BasicString copy(string, alloc_, 0);
+        swap_with_allocator(copy);
+      }
+    }
     return *this;
   }
 
-  void swap(String& string) {
+  void swap(BasicString& string) {
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+      std::swap(alloc_, string.alloc_);
+    }
     std::swap(array, string.array);
     std::swap(size_of_string, string.size_of_string);
     std::swap(size_of_memory, string.size_of_memory);
   }
 
-  void ChangeMemory() {
-    char* temp = new char[size_of_memory];
+  Alloc get_allocator() const {
+    return alloc_;
+  }
+
+  void ChangeMemory(size_t memory) {
+    char* temp = AllocTraits::allocate(alloc_, memory);
     memcpy(temp, array, size_of_string + 1);
-    delete[] array;
+    AllocTraits::deallocate(alloc_, array, size_of_memory);
     array = temp;
+    size_of_memory = memory;
   }
 
   char& operator[](size_t index) {
@@ -61,15 +112,14 @@ class String {
     return array[index];
   }
 
-  String& operator+=(char symbol) {
+  BasicString& operator+=(char symbol) {
     push_back(symbol);
     return *this;
   }
 
-  String& operator+=(const String& string) {
+  BasicString& operator+=(const BasicString& string) {
     if ((size_of_string + string.size_of_string + 1) > size_of_memory) {
-      size_of_memory = size_of_string + string.size_of_string + 1;
-      this->ChangeMemory();
+      this->ChangeMemory(size_of_string + string.size_of_string + 1);
     }
     memcpy(array + size_of_string, string.array, string.size_of_string + 1);
     size_of_string += string.size_of_string;
@@ -90,8 +140,7 @@ class String {
 
   void push_back(char symbol) {
     if ((size_of_string + 2) > size_of_memory) {
-      size_of_memory = size_of_string * 2 + 1;
-      this->ChangeMemory();
+      this->ChangeMemory(size_of_string * 2 + 2);
     }
     array[size_of_string++] = symbol;
     array[size_of_string] = 0;
@@ -119,7 +168,7 @@ class String {
     return array[size_of_string - 1];
   }
 
-  size_t find(const String& substring) const{
+  size_t find(const BasicString& substring) const{
     if (substring.size_of_string <= size_of_string) {
       for (size_t i = 0; i <= size_of_string - substring.size_of_string; i++) {
         if (strncmp(array + i, substring.array, substring.size_of_string) == 0) {
@@ -130,7 +179,7 @@ class String {
     return size_of_string;
   }
 
-  size_t rfind(const String& substring) const{
+  size_t rfind(const BasicString& substring) const{
     if (substring.size_of_string <= size_of_string) {
       for (int i = size_of_string - substring.size_of_string; i >= 0; i--) {
         if (strncmp(array + i, substring.array, substring.size_of_string) == 0) {
@@ -141,7 +190,7 @@ class String {
     return size_of_string;
   }
 
-  String substr(size_t index, size_t length) const{
+  BasicString substr(size_t index, size_t length) const{
     if (index > size_of_string) {
       length = 0;
       index = 0;
@@ -149,7 +198,7 @@ class String {
     if (length > size_of_string - index) {
       length = size_of_string - index;
     }
-    String result(length);
+    BasicString result(length, alloc_, 0);
     memcpy(result.array, array + index, length);
     return result;
   }
@@ -164,8 +213,7 @@ class String {
   }
 
   void shrink_to_fit() {
-    size_of_memory = size_of_string + 1;
-    this->ChangeMemory();
+    this->ChangeMemory(size_of_string + 1);
   }
 
   char* data() {
@@ -175,51 +223,53 @@ class String {
   const char* data() const {
     return array;
   }
-};
 
-bool operator==(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) == 0);
-}
-
-bool operator!=(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) != 0);
-}
-
-bool operator<(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) < 0);
-}
-
-bool operator>(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) > 0);
-}
-
-bool operator<=(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) <= 0);
-}
-
-bool operator>=(const String& first, const String& second) {
-  return (strcmp(first.data(), second.data()) >= 0);
-}
-
-String operator+(const String& first, const String& second) {
-  String result = first;
-  result += second;
-  return result;
-}
-
-std::ostream& operator<<(std::ostream& cout, const String& string) {
-  cout << string.data();
-  return cout;
-}
-
-std::istream& operator>>(std::istream& cin, String& string) {
-  string.clear();
-  char symbol;
-  while (cin.get(symbol)) {
-    if (isspace(symbol)) {
-      break;
+  friend bool operator==(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) == 0);
+  }
+
+  friend bool operator!=(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) != 0);
+  }
+
+  friend bool operator<(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) < 0);
+  }
+
+  friend bool operator>(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) > 0);
+  }
+
+  friend bool operator<=(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) <= 0);
+  }
+
+  friend bool operator>=(const BasicString& first, const BasicString& second) {
+    return (strcmp(first.data(), second.data()) >= 0);
+  }
+
+  friend BasicString operator+(const BasicString& first, const BasicString& second) {
+    BasicString result = first;
+    result += second;
+    return result;
+  }
+
+  friend std::ostream& operator<<(std::ostream& cout, const BasicString& string) {
+    cout << string.data();
+    return cout;
+  }
+
+  friend std::istream& operator>>(std::istream& cin, BasicString& string) {
+    string.clear();
+    char symbol;
+    while (cin.get(symbol)) {
+      if (isspace(symbol)) {
+        break;
+      }
+      string.push_back(symbol);
     }
-    string.push_back(symbol);
+    return cin;
   }
-  return cin;
-}
+};
+
+using String = BasicString<>;